@@ -3,14 +3,13 @@
 
 #include "calc.hpp"
 #include "chess.hpp"
+#include "eval.hpp"
 
 #include <list>
 #include <map>
 #include <string>
 #include <vector>
 
-extern int const eval_version;
-
 struct book_entry
 {
 	book_entry();
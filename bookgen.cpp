@@ -48,7 +48,7 @@ void print_remaining( timestamp const& start, uint64_t total, uint64_t calculate
 
 bool deepen_move( context& ctx, book& b, position const& p, seen_positions const& seen, std::vector<move> const& history, move const& m )
 {
-	ctx.tt_.init( ctx.conf_.memory );
+	ctx.tt_.init( ctx.conf_ );
 
 	if( !b.is_writable() ) {
 		std::cerr << "Cannot deepen move in read-only book." << std::endl;
@@ -99,7 +99,7 @@ bool deepen_move( context& ctx, book& b, position const& p, seen_positions const
 
 bool calculate_position( context& ctx, book& b, position const& p, seen_positions const& seen, std::vector<move> const& history )
 {
-	ctx.tt_.init( ctx.conf_.memory );
+	ctx.tt_.init( ctx.conf_ );
 
 	move_info moves[200];
 	move_info* pm = moves;
@@ -344,7 +344,7 @@ bool get_next( worklist& wl, work& w )
 
 void go( context& ctx, book& b, position const& p, seen_positions const& seen, std::vector<move> const& history, unsigned int max_depth, unsigned int max_width )
 {
-	ctx.tt_.init( ctx.conf_.memory );
+	ctx.tt_.init( ctx.conf_ );
 
 	max_depth += static_cast<unsigned int>(history.size());
 	if( max_depth > MAX_BOOK_DEPTH ) {
@@ -388,7 +388,7 @@ void go( context& ctx, book& b, position const& p, seen_positions const& seen, s
 
 void process( context& ctx, book& b )
 {
-	ctx.tt_.init( ctx.conf_.memory );
+	ctx.tt_.init( ctx.conf_ );
 
 	std::list<work> wl = b.get_unprocessed_positions();
 	if( wl.empty() ) {
@@ -415,7 +415,7 @@ void process( context& ctx, book& b )
 
 void update( context& ctx, book& b, int entries_per_pos = 5 )
 {
-	ctx.tt_.init( ctx.conf_.memory );
+	ctx.tt_.init( ctx.conf_ );
 
 	if( !b.is_writable() ) {
 		std::cerr << "Book is read-only" << std::endl;
@@ -657,7 +657,7 @@ bool do_deepen_tree( context& ctx, book& b, position const& p, seen_positions se
 
 bool deepen_tree( context& ctx, book& b, position const& p, seen_positions const& seen, std::vector<move> const& history, int offset )
 {
-	ctx.tt_.init( ctx.conf_.memory );
+	ctx.tt_.init( ctx.conf_ );
 
 	if( !b.is_writable() ) {
 		std::cerr << "Cannot deepen tree if book is read-only." << std::endl;
@@ -986,7 +986,7 @@ int main( int argc, char const* argv[] )
 	eval_values::init();
 	init_zobrist_tables();
 
-	ctx.pawn_tt_.init( ctx.conf_.pawn_hash_table_size() );
+	ctx.pawn_tt_.init( ctx.conf_ );
 
 	std::cout << "Opening book" << std::endl;
 
@@ -6,6 +6,7 @@
 #include "fen.hpp"
 #include "hash.hpp"
 #include "moves.hpp"
+#include "pawn_structure_hash_table.hpp"
 #include "phased_move_generator.hpp"
 #include "random.hpp"
 #include "see.hpp"
@@ -14,6 +15,7 @@
 #include "util/logger.hpp"
 #include "util/mutex.hpp"
 #include "util/thread.hpp"
+#include "util/thread_set.hpp"
 #include "util.hpp"
 
 #include <algorithm>
@@ -102,7 +104,31 @@ Things to consider:
 - Find a good minimum split depth. If it's too low, overhead becomes too large
 - Synchronization overhead. Need to keep things fast. Start with a cheap idle check on a volatile bool and then
   only do the slow locking if things look promising
+
+Multiple split points:
+- Each thread keeps a stack of the split points it is the master of. Any number of split points can be active at
+  the same time, limited only by the per-thread stack size.
+- Idle threads steal work from any active split point that still has moves left. The split point with the highest
+  remaining depth is preferred, as it has the largest subtree left to search.
+- A master waiting on its own split point only helps at that split point or at split points below it in the
+  tree, as it needs to return to its own split point once that is done.
 */
+struct move_data {
+	move_data()
+		: depth( 1 )
+		, seldepth( 1 )
+	{
+	}
+
+	move_info m;
+	move pv[MAX_DEPTH];
+	unsigned int depth;
+	unsigned int seldepth;
+};
+
+typedef std::vector<move_data> sorted_moves;
+
+
 class thread_pool;
 namespace {
 class work;
@@ -111,10 +137,29 @@ class worker_thread : public thread
 {
 public:
 	worker_thread( thread_pool& pool, uint64_t thread_index );
+	virtual ~worker_thread();
 
 	virtual void onRun();
 
-	void process_work( scoped_lock& l );
+	// In NUMA mode, pins the thread and moves its calc_states to the local
+	// node. Needs to be called from within the thread itself.
+	void update_placement();
+
+	// Switches the calc_states between the shared pawn structure hash table
+	// and the thread's own one. Also called from within the thread, so that
+	// the thread's table is local to it in NUMA mode.
+	void update_pawn_table();
+
+	// If restrict is set, only work at that split point and split points below it is processed.
+	void process_work( scoped_lock& l, work* restrict = 0 );
+
+	// Lazy SMP: Runs an independent iterative deepening loop from the root
+	// until told to stop.
+	void process_helper( scoped_lock& l );
+
+	// Searches all root moves to the given depth. Moves get re-sorted as
+	// better ones are found.
+	void search_root( calc_state& state, position const& p, sorted_moves& moves, seen_positions const& seen, unsigned int max_depth, std::size_t multipv );
 
 	condition cond_;
 
@@ -129,31 +174,42 @@ public:
 #endif
 	};
 
-	calc_state calc_states_[max_calc_states];
+	// Separately allocated on their own pages so that they can be moved to
+	// the NUMA node the thread runs on.
+	calc_state* calc_states_;
 	unsigned int state_it_;
 
+	// Node the thread is pinned to, -1 if not pinned
+	int numa_node_;
+
+	// Only used if the pool has per-thread pawn structure hash tables
+	pawn_structure_hash_table pawn_tt_;
+
+	// Shared by the thread's calc_states
+	eval_cache eval_cache_;
+
 	thread_pool& pool_;
 	uint64_t thread_index_;
 
 	work* current_work_;
-};
 
-
-struct move_data {
-	move_data()
-		: depth( 1 )
-		, seldepth( 1 )
-	{
-	}
-
-	move_info m;
-	move pv[MAX_DEPTH];
-	unsigned int depth;
-	unsigned int seldepth;
+	// Stack of active split points this thread is the master of
+	work* split_points_[max_calc_states];
+	unsigned int split_point_count_;
+
+	// Root of the helper search, only used in Lazy SMP mode
+	bool helper_;
+	volatile bool helper_stop_;
+	position helper_pos_;
+	sorted_moves helper_moves_;
+	seen_positions helper_seen_;
+	unsigned int helper_min_depth_;
+	unsigned int helper_max_depth_;
+
+protected:
+	virtual void on_new_root_best( std::size_t ) {}
 };
 
-typedef std::vector<move_data> sorted_moves;
-
 
 class master_worker_thread : public worker_thread
 {
@@ -186,6 +242,8 @@ private:
 
 	void process_root( scoped_lock& l );
 
+	virtual void on_new_root_best( std::size_t updated ) override;
+
 	void print_best( unsigned int updated );
 
 	bool idle_;
@@ -228,8 +286,8 @@ public:
 
 	worker_thread* master_;
 	
-	uint64_t active_workers_;
-	unsigned char active_worker_calc_states_[64];
+	thread_set active_workers_;
+	unsigned char active_worker_calc_states_[MAX_THREADS];
 
 	// True if there has been a cutoff
 	bool cutoff_;
@@ -248,6 +306,15 @@ bool cutoff_in_tree( work* w )
 	return w != 0;
 }
 
+// Returns true if w is root or below root in the tree of split points
+bool in_subtree( work* w, work* root )
+{
+	while( w && w != root ) {
+		w = w->parent_split_;
+	}
+	return w != 0;
+}
+
 work::work( worker_thread* master, int depth, int ply, position const& p
 		, check_map const& check, short alpha, short beta, short full_eval
 		, unsigned char last_ply_was_capture, bool pv_node, short& best_value, move& best_move, phased_move_generator_base& gen
@@ -284,22 +351,42 @@ public:
 
 	void update_threads();
 	void reduce_histories();
+	void clear_eval_caches();
 
 	void abort( scoped_lock& l );
 	void clear_abort();
 	void wait_for_idle( scoped_lock& l );
 
+	// Lazy SMP: Let all threads but the master search independently from the root
+	void start_helpers( scoped_lock& l, position const& p, sorted_moves const& moves, seen_positions const& seen, unsigned int min_depth, unsigned int max_depth );
+	void stop_helpers( scoped_lock& l );
+
 	context& ctx_;
 	
 	volatile bool idle_;
 
+	// If set, threads do not split but search independently from the root.
+	bool lazy_smp_;
+
+	// If set, threads get pinned and use node-local memory.
+	bool numa_;
+
+	// Size of the per-thread pawn structure hash tables, 0 to share the
+	// one of the context.
+	unsigned int pawn_tt_size_;
+
+	unsigned int active_helpers_;
+	condition helpers_cond_;
+
 	mutex& m_;
 
-	work* work_;
+	// Returns the most promising split point that still has moves left.
+	// If restrict is set, only split points in its subtree are considered.
+	work* find_work( work* restrict );
 
 	master_worker_thread* master() { return threads_.empty() ? 0 : reinterpret_cast<master_worker_thread*>(threads_[0]); }
 
-	uint64_t idle_threads_;
+	thread_set idle_threads_;
 	std::vector<worker_thread*> threads_;
 
 #if USE_STATISTICS
@@ -311,13 +398,16 @@ public:
 thread_pool::thread_pool( context& ctx, mutex& m )
 	: ctx_(ctx)
 	, idle_(true)
+	, lazy_smp_()
+	, numa_()
+	, pawn_tt_size_()
+	, active_helpers_()
 	, m_(m)
-	, work_()
 	, idle_threads_()
 {
 	scoped_lock l( m_ );
 
-	for( unsigned int i = 0; i < std::min( 64u, ctx_.conf_.thread_count ); ++i ) {
+	for( unsigned int i = 0; i < std::min( static_cast<unsigned int>(MAX_THREADS), ctx_.conf_.thread_count ); ++i ) {
 		worker_thread* t;
 		if( !i ) {
 			t = new master_worker_thread( *this, i );
@@ -325,7 +415,7 @@ thread_pool::thread_pool( context& ctx, mutex& m )
 		else {
 			t = new worker_thread( *this, i );
 		}
-		idle_threads_ |= 1ull << i;
+		idle_threads_.set( i );
 		threads_.push_back( t );
 		t->spawn();
 	}
@@ -351,13 +441,17 @@ thread_pool::~thread_pool()
 }
 
 
-void thread_pool::abort( scoped_lock& )
+void thread_pool::abort( scoped_lock& l )
 {
-	if( work_ ) {
-		work_->gen_.set_done();
-		work_ = 0;
-	}
 	for( auto thread : threads_ ) {
+		for( unsigned int i = 0; i < thread->split_point_count_; ++i ) {
+			work* w = thread->split_points_[i];
+			w->gen_.set_done();
+			if( w->active_workers_.empty() && !w->done_ ) {
+				w->done_ = true;
+				w->master_->cond_.signal( l );
+			}
+		}
 		thread->do_abort_ = true;
 		for( unsigned int i = 0; i < thread->max_calc_states; ++i ) {
 			thread->calc_states_[i].do_abort_ = true;
@@ -374,6 +468,28 @@ void thread_pool::clear_abort()
 }
 
 
+work* thread_pool::find_work( work* restrict )
+{
+	work* best = 0;
+	for( auto thread : threads_ ) {
+		for( unsigned int i = 0; i < thread->split_point_count_; ++i ) {
+			work* w = thread->split_points_[i];
+			if( w->cutoff_ || w->gen_.get_phase() == phases::done ) {
+				continue;
+			}
+			if( restrict && !in_subtree( w, restrict ) ) {
+				continue;
+			}
+			if( !best || w->depth_ > best->depth_ ) {
+				best = w;
+			}
+		}
+	}
+
+	return best;
+}
+
+
 void thread_pool::wait_for_idle( scoped_lock& l )
 {
 	while( !master()->idle() ) {
@@ -384,13 +500,23 @@ void thread_pool::wait_for_idle( scoped_lock& l )
 
 void thread_pool::update_threads()
 {
-	unsigned int const thread_count = std::min( 64u, ctx_.conf_.thread_count );
+	unsigned int const thread_count = std::min( static_cast<unsigned int>(MAX_THREADS), ctx_.conf_.thread_count );
 	ASSERT( thread_count > 0 );
 	ASSERT( idle_ );
+	ASSERT( !active_helpers_ );
+
+	lazy_smp_ = ctx_.conf_.smp == smp_mode::lazy;
+	if( numa_ != ctx_.conf_.numa ) {
+		numa_ = ctx_.conf_.numa;
+		if( numa_ ) {
+			dlog() << "NUMA mode enabled, found " << get_numa_node_count() << " node(s)" << std::endl;
+		}
+	}
+	pawn_tt_size_ = ctx_.conf_.per_thread_pawn_hash ? ctx_.conf_.per_thread_pawn_hash_table_size() : 0;
 
 	while( threads_.size() < thread_count ) {
 		worker_thread* t = new worker_thread( *this, threads_.size() );
-		idle_threads_ |= 1ull << threads_.size();
+		idle_threads_.set( threads_.size() );
 		threads_.push_back( t );
 		t->spawn();
 	}
@@ -405,14 +531,56 @@ void thread_pool::update_threads()
 		}
 
 		(*it)->join();
-		idle_threads_ &= ~(1ull << (*it)->thread_index_);
+		idle_threads_.reset( (*it)->thread_index_ );
 		delete *it;
 		threads_.erase( it );
 	}
 
-	ASSERT( threads_.size() == popcount(idle_threads_) );
+	ASSERT( threads_.size() == idle_threads_.count() );
 }
 
+void thread_pool::start_helpers( scoped_lock& l, position const& p, sorted_moves const& moves, seen_positions const& seen, unsigned int min_depth, unsigned int max_depth )
+{
+	if( !lazy_smp_ ) {
+		return;
+	}
+
+	for( std::size_t i = 1; i < threads_.size(); ++i ) {
+		worker_thread* t = threads_[i];
+		ASSERT( !t->helper_ );
+
+		t->helper_pos_ = p;
+		t->helper_moves_ = moves;
+		t->helper_seen_ = seen;
+
+		// Stagger depths, every other helper starts one ply deeper.
+		t->helper_min_depth_ = min_depth + (i & 1);
+		t->helper_max_depth_ = max_depth;
+
+		t->helper_stop_ = false;
+		t->helper_ = true;
+		++active_helpers_;
+
+		t->cond_.signal( l );
+	}
+}
+
+
+void thread_pool::stop_helpers( scoped_lock& l )
+{
+	for( auto thread : threads_ ) {
+		if( thread->helper_ ) {
+			thread->helper_stop_ = true;
+			thread->calc_states_[0].do_abort_ = true;
+		}
+	}
+
+	while( active_helpers_ ) {
+		helpers_cond_.wait( l );
+	}
+}
+
+
 void thread_pool::reduce_histories()
 {
 	for( auto thread : threads_ ) {
@@ -422,18 +590,86 @@ void thread_pool::reduce_histories()
 	}
 }
 
+
+void thread_pool::clear_eval_caches()
+{
+	// The evaluation values might have changed since the last search.
+	for( auto thread : threads_ ) {
+		thread->eval_cache_.clear();
+	}
+}
+
 worker_thread::worker_thread( thread_pool& pool, uint64_t thread_index )
 	: quit_()
 	, do_abort_()
+	, calc_states_()
 	, state_it_()
+	, numa_node_(-1)
 	, pool_(pool)
 	, thread_index_(thread_index)
 	, current_work_()
+	, split_point_count_()
+	, helper_()
+	, helper_stop_()
+	, helper_min_depth_()
+	, helper_max_depth_()
 {
+	void* p = page_aligned_malloc( sizeof(calc_state) * max_calc_states );
+	if( !p ) {
+		abort();
+	}
+	calc_states_ = reinterpret_cast<calc_state*>(p);
+
 	for( unsigned int i = 0; i < max_calc_states; ++i ) {
+		new (calc_states_ + i) calc_state();
 		calc_states_[i].thread_ = this;
 		calc_states_[i].tt_ = &pool.ctx_.tt_;
 		calc_states_[i].pawn_tt_ = &pool.ctx_.pawn_tt_;
+		calc_states_[i].eval_cache_ = &eval_cache_;
+	}
+}
+
+
+worker_thread::~worker_thread()
+{
+	for( unsigned int i = 0; i < max_calc_states; ++i ) {
+		calc_states_[i].~calc_state();
+	}
+	aligned_free( calc_states_ );
+}
+
+
+void worker_thread::update_placement()
+{
+	if( pool_.numa_ == (numa_node_ != -1) ) {
+		return;
+	}
+
+	if( pool_.numa_ ) {
+		numa_node_ = static_cast<int>(pin_thread( thread_index_ ));
+		bind_memory_to_node( calc_states_, sizeof(calc_state) * max_calc_states, numa_node_ );
+		bind_memory_to_node( eval_cache_.data(), eval_cache_.size(), numa_node_ );
+	}
+	else {
+		unpin_thread();
+		numa_node_ = -1;
+	}
+}
+
+
+void worker_thread::update_pawn_table()
+{
+	pawn_structure_hash_table* pawn_tt = &pool_.ctx_.pawn_tt_;
+	if( pool_.pawn_tt_size_ ) {
+		pawn_tt_.init( pool_.pawn_tt_size_ );
+		pawn_tt = &pawn_tt_;
+	}
+	else {
+		pawn_tt_.init( 0 );
+	}
+
+	for( unsigned int i = 0; i < max_calc_states; ++i ) {
+		calc_states_[i].pawn_tt_ = pawn_tt;
 	}
 }
 
@@ -442,30 +678,55 @@ void worker_thread::onRun()
 	scoped_lock l( pool_.m_ );
 	while( !quit_ ) {
 
-		pool_.idle_threads_ |= 1ull << thread_index_;
+		pool_.idle_threads_.set( thread_index_ );
 		pool_.idle_ = true;
 
 		cond_.wait( l );
 		
-		pool_.idle_threads_ &= ~(1ull << thread_index_);
-		if( !pool_.idle_threads_ ) {
+		pool_.idle_threads_.reset( thread_index_ );
+		if( pool_.idle_threads_.empty() ) {
 			pool_.idle_ = false;
 		}
 
-		process_work( l );
+		update_placement();
+		update_pawn_table();
+
+		if( helper_ ) {
+			process_helper( l );
+		}
+		else {
+			process_work( l );
+		}
+	}
+}
+
+void worker_thread::process_helper( scoped_lock& l )
+{
+	calc_state& state = calc_states_[0];
+	state.do_abort_ = false;
+
+	l.unlock();
+
+	for( unsigned int depth = helper_min_depth_; depth <= helper_max_depth_ && !helper_stop_ && !do_abort_; ++depth ) {
+		search_root( state, helper_pos_, helper_moves_, helper_seen_, depth, 1 );
+	}
+
+	l.lock();
+
+	helper_ = false;
+	ASSERT( pool_.active_helpers_ > 0 );
+	if( !--pool_.active_helpers_ ) {
+		pool_.helpers_cond_.signal( l );
 	}
 }
 
-void worker_thread::process_work( scoped_lock& l )
+void worker_thread::process_work( scoped_lock& l, work* restrict )
 {
 	work* w;
-	while( (w = pool_.work_) && !quit_ && !do_abort_ ) {
+	while( !quit_ && !do_abort_ && (w = pool_.find_work( restrict )) ) {
 
 		ASSERT( !w->cutoff_ );
 		if( cutoff_in_tree( w->parent_split_ ) ) {
-			if( pool_.work_ == w ) {
-				pool_.work_ = 0;
-			}
 			w->cutoff_ = true;
 			w->gen_.set_done();
 		}
@@ -479,8 +740,8 @@ void worker_thread::process_work( scoped_lock& l )
 				calc_state& state = calc_states_[state_it_];
 				state.do_abort_ = false;
 
-				ASSERT( !(w->active_workers_ & (1ull << thread_index_)) );
-				w->active_workers_ |= 1ull << thread_index_;
+				ASSERT( !w->active_workers_.test( thread_index_ ) );
+				w->active_workers_.set( thread_index_ );
 				w->active_worker_calc_states_[thread_index_] = state_it_++;
 			
 				// Extract non-const data
@@ -497,6 +758,7 @@ void worker_thread::process_work( scoped_lock& l )
 				state.move_ptr = state.moves;
 				state.seen.clone_from( w->master_state_.seen, w->ply_ );
 
+				state.nnue_.reset( w->p_ );
 				short value = state.inner_step( w->depth_, w->ply_, w->p_, w->check_, alpha, w->beta_, w->full_eval_
 					, w->last_ply_was_capture_, w->pv_node_, m, processed, phase, best_value );
 
@@ -504,8 +766,8 @@ void worker_thread::process_work( scoped_lock& l )
 
 				current_work_ = old_work;
 
-				ASSERT( w->active_workers_ & (1ull << thread_index_) );
-				w->active_workers_ &= ~(1ull << thread_index_);
+				ASSERT( w->active_workers_.test( thread_index_ ) );
+				w->active_workers_.reset( thread_index_ );
 
 				ASSERT( state_it_ > 0 );
 				--state_it_;
@@ -528,15 +790,12 @@ void worker_thread::process_work( scoped_lock& l )
 								}
 
 								// We're done, with cutoff
-								if( pool_.work_ == w ) {
-									pool_.work_ = 0;
-								}
 								w->cutoff_ = true;
 
 								// Abort other workers
-								uint64_t active = w->active_workers_;
-								while( active ) {
-									uint64_t index = bitscan_unset( active );
+								thread_set active = w->active_workers_;
+								while( !active.empty() ) {
+									uint64_t index = active.pop_first();
 									pool_.threads_[index]->calc_states_[w->active_worker_calc_states_[index]].do_abort_ = true;
 								}
 								w->gen_.set_done();
@@ -554,12 +813,11 @@ void worker_thread::process_work( scoped_lock& l )
 			}
 			else {
 				// Not much more to do with this node
-				pool_.work_ = 0;
 				ASSERT( w->gen_.get_phase() == phases::done );
 			}
 		}
 
-		if( w->gen_.get_phase() == phases::done && !w->active_workers_ && !w->done_ ) {
+		if( w->gen_.get_phase() == phases::done && w->active_workers_.empty() && !w->done_ ) {
 			w->done_ = true;
 			w->master_->cond_.signal( l );
 		}
@@ -585,19 +843,22 @@ void master_worker_thread::onRun()
 		}
 		else if( !idle_ ) {
 
-			pool_.idle_threads_ &= ~(1ull << thread_index_);
-			if( !pool_.idle_threads_ ) {
+			pool_.idle_threads_.reset( thread_index_ );
+			if( pool_.idle_threads_.empty() ) {
 				pool_.idle_ = false;
 			}
 
+			update_placement();
+			update_pawn_table();
+
 			process_root( l );
 
 			idle_ = true;
 			calc_cond_.signal( l );
 
-			pool_.idle_threads_ |= 1ull << thread_index_;
+			pool_.idle_threads_.set( thread_index_ );
 			pool_.idle_ = true;
-			ASSERT( popcount(pool_.idle_threads_) == pool_.threads_.size() );
+			ASSERT( pool_.lazy_smp_ || pool_.idle_threads_.count() == pool_.threads_.size() );
 		}
 	}
 }
@@ -610,18 +871,33 @@ void master_worker_thread::process_root( scoped_lock& l )
 
 	l.unlock();
 
+	search_root( state, p_, moves_, seen_, max_depth_, multipv_ );
+
+	l.lock();
+}
+
+
+void master_worker_thread::on_new_root_best( std::size_t updated )
+{
+	print_best( static_cast<unsigned int>(updated) );
+}
+
+
+void worker_thread::search_root( calc_state& state, position const& p, sorted_moves& moves, seen_positions const& seen, unsigned int max_depth, std::size_t multipv )
+{
 	short root_alpha = result::loss;
 	short root_beta = result::win;
 
-	std::size_t const multipv = std::min( moves_.size(), multipv_ );
+	multipv = std::min( moves.size(), multipv );
 
-	for( std::size_t i = 0; i < moves_.size() && !do_abort_; ++i ) {
-		move_data& d = moves_[i];
+	for( std::size_t i = 0; i < moves.size() && !do_abort_ && !state.do_abort_; ++i ) {
+		move_data& d = moves[i];
 
-		position new_pos = p_;
+		position new_pos = p;
 		apply_move( new_pos, d.m.m );
+		state.nnue_.reset( new_pos );
 
-		state.seen = seen_;
+		state.seen = seen;
 		state.move_ptr = state.moves;
 
 		short value;
@@ -635,14 +911,14 @@ void master_worker_thread::process_root( scoped_lock& l )
 
 			// Search using aspiration window:
 			value = result::loss;
-			if( root_alpha == result::loss && d.m.sort != result::loss && max_depth_ > 4 ) {
+			if( root_alpha == result::loss && d.m.sort != result::loss && max_depth > 4 ) {
 
 				int aspiration = 10;
 				short alpha = std::max( static_cast<short>(result::loss), static_cast<short>(d.m.sort - aspiration) );
 				short beta = std::min( static_cast<short>(result::win), static_cast<short>(d.m.sort + aspiration) );
 
 				while( value == result::loss ) {
-					short value = -state.step( max_depth_ * DEPTH_FACTOR + MAX_QDEPTH + 1, 1, new_pos, check, -beta, -alpha, false );
+					short value = -state.step( max_depth * DEPTH_FACTOR + MAX_QDEPTH + 1, 1, new_pos, check, -beta, -alpha, false );
 					if( value >= beta ) {
 						if( result::win - aspiration > beta ) {
 							beta += aspiration;
@@ -667,41 +943,38 @@ void master_worker_thread::process_root( scoped_lock& l )
 			}
 
 			if( root_alpha != result::loss && value == result::loss ) {
-				short v = -state.step( max_depth_ * DEPTH_FACTOR + MAX_QDEPTH + 1, 1, new_pos, check, -root_alpha-1, -root_alpha, false );
+				short v = -state.step( max_depth * DEPTH_FACTOR + MAX_QDEPTH + 1, 1, new_pos, check, -root_alpha-1, -root_alpha, false );
 				if( v <= root_alpha ) {
 					value = v;
 				}
 			}
 			
 			if( value == result::loss ) {
-				value = -state.step( max_depth_ * DEPTH_FACTOR + MAX_QDEPTH + 1, 1, new_pos, check, -root_beta, -root_alpha, false );
+				value = -state.step( max_depth * DEPTH_FACTOR + MAX_QDEPTH + 1, 1, new_pos, check, -root_beta, -root_alpha, false );
 			}
 		}
 
-		if( value > root_alpha && !do_abort_ ) {
+		if( value > root_alpha && !do_abort_ && !state.do_abort_ ) {
 			// Bubble new best to front
 			d.m.sort = value;
-			d.depth = max_depth_;
+			d.depth = max_depth;
 #if USE_STATISTICS
 			d.seldepth = pool_.stats_.highest_depth();
 #endif
-			get_pv_from_tt( *state.tt_, d.pv, p_, max_depth_ );
+			get_pv_from_tt( *state.tt_, d.pv, p, max_depth );
 			std::size_t j;
-			for( j = i; j > 0 && (j > multipv || moves_[j-1].m.sort < value); --j ) {
-				std::swap( moves_[j], moves_[j-1] );
+			for( j = i; j > 0 && (j > multipv || moves[j-1].m.sort < value); --j ) {
+				std::swap( moves[j], moves[j-1] );
 			}
 
-			// Print new results
-			print_best( static_cast<unsigned int>(j) );
+			on_new_root_best( j );
 	
 			if( i + 1 >= multipv ) {
 				// All PVs searched full with. Now we can use null windows.
-				root_alpha = moves_[multipv-1].m.sort;
+				root_alpha = moves[multipv-1].m.sort;
 			}
 		}
 	}
-
-	l.lock();
 }
 
 
@@ -763,7 +1036,7 @@ void calc_state::split( int depth, int ply, position const& p
 		, check_map const& check, short alpha, short beta, short full_eval, unsigned char last_ply_was_capture, bool pv_node, short& best_value, move& best_move, phased_move_generator_base& gen )
 {
 	ASSERT( thread_ );
-	if( !thread_->pool_.idle_ ) {
+	if( thread_->pool_.lazy_smp_ || !thread_->pool_.idle_ ) {
 		return;
 	}
 
@@ -774,7 +1047,7 @@ void calc_state::split( int depth, int ply, position const& p
 	}
 
 	// Recheck idle condition now that we got the lock
-	if( thread_->pool_.work_ || !thread_->pool_.idle_threads_ ) {
+	if( thread_->pool_.idle_threads_.empty() || thread_->split_point_count_ >= thread_->max_calc_states ) {
 		return;
 	}
 
@@ -788,12 +1061,12 @@ void calc_state::split( int depth, int ply, position const& p
 
 	// Queue work
 	work w( thread_, depth, ply, p, check, alpha, beta, full_eval, last_ply_was_capture, pv_node, best_value, best_move, gen, *this );
-	thread_->pool_.work_ = &w;
+	thread_->split_points_[thread_->split_point_count_++] = &w;
 
 	// Wake up idle workers
-	uint64_t idle = thread_->pool_.idle_threads_;
-	while( idle ) {
-		uint64_t index = bitscan_unset( idle ); 
+	thread_set idle = thread_->pool_.idle_threads_;
+	while( !idle.empty() ) {
+		uint64_t index = idle.pop_first();
 		thread_->pool_.threads_[index]->cond_.signal( l );
 	}
 
@@ -801,20 +1074,17 @@ void calc_state::split( int depth, int ply, position const& p
 		if( thread_->state_it_ < thread_->max_calc_states ) {
 			// Be a helpful master and participate in the search, if it either
 			// is our own split point, or belongs to a slave.
-			work* pw = thread_->pool_.work_;
-			while( pw && pw != &w ) {
-				pw = pw->parent_split_;
-			}
-			if( pw == &w ) {
-				thread_->process_work( l );
+			if( thread_->pool_.find_work( &w ) ) {
+				thread_->process_work( l, &w );
 				continue;
 			}
 		}
 
 		thread_->cond_.wait( l );
 	}
-	ASSERT( !w.active_workers_ );
-	ASSERT( thread_->pool_.work_ != &w );
+	ASSERT( w.active_workers_.empty() );
+	ASSERT( thread_->split_point_count_ > 0 && thread_->split_points_[thread_->split_point_count_ - 1] == &w );
+	--thread_->split_point_count_;
 
 	{
 		if( cutoff_in_tree( thread_->current_work_ ) ) {
@@ -891,7 +1161,7 @@ short calc_state::quiescence_search( int ply, int depth, position const& p, chec
 
 	if( !check.check ) {
 		if( full_eval == result::win ) {
-			full_eval = evaluate_full( *pawn_tt_, p );
+			full_eval = evaluate( p );
 		}
 		if( full_eval > alpha ) {
 			if( full_eval >= beta ) {
@@ -919,12 +1189,18 @@ short calc_state::quiescence_search( int ply, int depth, position const& p, chec
 		pieces::type piece = p.get_piece( m.source() );
 		pieces::type captured_piece = p.get_captured_piece( m );
 		
-		position new_pos(p);
+		position new_pos( p );
+		nnue_.push( p, m );
 		apply_move( new_pos, m );
+		tt_->prefetch( new_pos.hash_ );
+		if( new_pos.pawn_hash != p.pawn_hash ) {
+			pawn_tt_->prefetch( new_pos.pawn_hash );
+		}
 
 		check_map new_check( new_pos );
 		
 		if( captured_piece == pieces::none && !check.check && !new_check.check ) {
+			nnue_.pop();
 			continue;
 		}
 
@@ -935,11 +1211,13 @@ short calc_state::quiescence_search( int ply, int depth, position const& p, chec
 				if( new_value > best_value ) {
 					best_value = new_value;
 				}
+				nnue_.pop();
 				continue;
 			}
 		}
 
 		short value = -quiescence_search( ply + 1, depth - 1, new_pos, new_check, -beta, -alpha );
+		nnue_.pop();
 
 		if( value > best_value ) {
 			best_value = value;
@@ -968,6 +1246,19 @@ short calc_state::quiescence_search( int ply, int depth, position const& p, chec
 }
 
 
+short calc_state::evaluate( position const& p )
+{
+	short eval;
+	if( !eval_cache_->lookup( p.hash_, eval ) ) {
+		eval = nnue_.active() ? nnue_.evaluate( p ) : evaluate_full( *pawn_tt_, p );
+		eval_cache_->store( p.hash_, eval );
+	}
+	ASSERT( eval == evaluate_full( *pawn_tt_, p ) );
+
+	return eval;
+}
+
+
 short calc_state::step( int depth, int ply, position& p, check_map const& check, short alpha, short beta, bool last_was_null, short full_eval, unsigned char last_ply_was_capture )
 {
 #if VERIFY_HASH
@@ -1038,10 +1329,7 @@ short calc_state::step( int depth, int ply, position& p, check_map const& check,
 	int plies_remaining = (depth - cutoff) / DEPTH_FACTOR;
 
 	if( !pv_node && !check.check /*&& plies_remaining < 4*/ && full_eval == result::win ) {
-		full_eval = evaluate_full( *pawn_tt_, p );
-		if( tt_move.empty() && t == score_type::none ) {
-			tt_->store( p.hash_, 0, ply, 0, 0, 0, tt_move, clock, full_eval );
-		}
+		full_eval = evaluate( p );
 	}
 
 	if( !pv_node && !check.check && plies_remaining < static_cast<int>(sizeof(razor_pruning)/sizeof(short)) && full_eval + razor_pruning[plies_remaining] < beta &&
@@ -1066,6 +1354,7 @@ short calc_state::step( int depth, int ply, position& p, check_map const& check,
 
 		{
 			unsigned char old_enpassant = p.do_null_move();
+			tt_->prefetch( p.hash_ );
 
 			null_move_block seen_block( seen, p.hash_, ply );
 
@@ -1173,14 +1462,23 @@ short calc_state::inner_step( int const depth, int const ply, position const& p,
 						  , short const full_eval, unsigned char const last_ply_was_capture
 						  , bool const pv_node, move const& m, unsigned int const processed_moves, phases::type const phase, short const best_value )
 {
-	short value;
+	short value = result::none;
 
 	pieces::type piece = p.get_piece( m );
 	pieces::type captured_piece = p.get_captured_piece( m );
 
-	position new_pos(p);
+	// Copy-make, so that the SEE below can look at p and only has to be done
+	// for moves that do not give check.
+	position new_pos( p );
+	nnue_.push( p, m );
 	apply_move( new_pos, m );
 
+	// The child looks these up first thing, start loading them now.
+	tt_->prefetch( new_pos.hash_ );
+	if( new_pos.pawn_hash != p.pawn_hash ) {
+		pawn_tt_->prefetch( new_pos.pawn_hash );
+	}
+
 	if( seen.is_two_fold( new_pos.hash_, ply ) ) {
 		value = result::draw;
 	}
@@ -1204,16 +1502,8 @@ short calc_state::inner_step( int const depth, int const ply, position const& p,
 
 		// Pawn push extension
 		if( piece == pieces::pawn ) {
-			// Pawn promoting or moving to 7th rank
-			if( m.target() < 16 || m.target() >= 48 ) {
-				dangerous_pawn_move = true;
-				if( !extended && pv_node ) {
-					new_depth += pawn_push_extension;
-					extended = true;
-				}
-			}
-			// Pushing a passed pawn
-			else if( !(passed_pawns[p.self()][m.target()] & p.bitboards[p.other()][bb_type::pawns] ) ) {
+			// Pawn promoting or moving to 7th rank, or pushing a passed pawn
+			if( m.target() < 16 || m.target() >= 48 || !(passed_pawns[p.self()][m.target()] & p.bitboards[p.other()][bb_type::pawns] ) ) {
 				dangerous_pawn_move = true;
 				if( !extended && pv_node ) {
 					new_depth += pawn_push_extension;
@@ -1223,7 +1513,7 @@ short calc_state::inner_step( int const depth, int const ply, position const& p,
 		}
 
 		// Recapture extension
-		if( !extended && pv_node && captured_piece != pieces::none && m.target() == last_ply_was_capture && see(p, m) >= 0 ) {
+		if( !extended && pv_node && captured_piece != pieces::none && m.target() == last_ply_was_capture && see( p, m ) >= 0 ) {
 			new_depth += recapture_extension;
 			extended = true;
 		}
@@ -1232,6 +1522,8 @@ short calc_state::inner_step( int const depth, int const ply, position const& p,
 			new_capture = m.target();
 		}
 
+		bool pruned = false;
+
 		// Open question: What's the exact reason for always searching exactly the first move full width?
 		// Why not always use PVS, or at least in those cases where root alpha isn't result::loss?
 		// Why not use full width unless alpha > old_alpha?
@@ -1244,46 +1536,45 @@ short calc_state::inner_step( int const depth, int const ply, position const& p,
 				( best_value == result::loss || best_value > result::loss_threshold ) )
 			{
 				int plies_remaining = (depth - cutoff) / DEPTH_FACTOR;
-				if( plies_remaining < static_cast<int>(sizeof(futility_pruning)/sizeof(short))) {
-					value = full_eval + futility_pruning[plies_remaining];
-					if( value <= alpha ) {
-						return result::none;
-					}
+				if( plies_remaining < static_cast<int>(sizeof(futility_pruning)/sizeof(short)) && full_eval + futility_pruning[plies_remaining] <= alpha ) {
+					pruned = true;
 				}
-
-				if( new_depth < cutoff + DEPTH_FACTOR && see( p, m ) < 0 ) {
-					return result::none;
+				else if( new_depth < cutoff + DEPTH_FACTOR && see( p, m ) < 0 ) {
+					pruned = true;
 				}
 			}
-
 #endif
 
-			bool search_full;
-			if( !extended && processed_moves >= (pv_node ? 5u : 3u) && phase >= phases::noncapture &&
-				!check.check && depth >= lmr_min_depth )
-			{
-				int red = pv_node ? (DEPTH_FACTOR) : (DEPTH_FACTOR * 2);
+			if( !pruned ) {
+				bool search_full;
+				if( !extended && processed_moves >= (pv_node ? 5u : 3u) && phase >= phases::noncapture &&
+					!check.check && depth >= lmr_min_depth )
+				{
+					int red = pv_node ? (DEPTH_FACTOR) : (DEPTH_FACTOR * 2);
 
-				red += (processed_moves - (pv_node?3:3)) / 5;
-				int lmr_depth = new_depth - red;
-				value = -step(lmr_depth, ply + 1, new_pos, new_check, -alpha-1, -alpha, false );
+					red += (processed_moves - (pv_node?3:3)) / 5;
+					int lmr_depth = new_depth - red;
+					value = -step(lmr_depth, ply + 1, new_pos, new_check, -alpha-1, -alpha, false );
 
-				search_full = value > alpha;
-			}
-			else {
-				search_full = true;
-			}
+					search_full = value > alpha;
+				}
+				else {
+					search_full = true;
+				}
 
-			if( search_full ) {
-				value = -step( new_depth, ply + 1, new_pos, new_check, -alpha-1, -alpha, false, result::win, new_capture );
+				if( search_full ) {
+					value = -step( new_depth, ply + 1, new_pos, new_check, -alpha-1, -alpha, false, result::win, new_capture );
+				}
 			}
 		}
 
-		if( pv_node && (!processed_moves || (value > alpha && value < beta) ) ) {
+		if( !pruned && pv_node && (!processed_moves || (value > alpha && value < beta) ) ) {
 			value = -step( new_depth, ply + 1, new_pos, new_check, -beta, -alpha, false, result::win, new_capture );
 		}
 	}
 
+	nnue_.pop();
+
 	return value;
 }
 
@@ -1360,8 +1651,11 @@ calc_result calc_manager::calc( position const& p, int max_depth, timestamp cons
 
 	max_depth = impl_->get_max_depth( max_depth );
 
+	clock = impl_->ctx_.tt_.new_search( static_cast<unsigned char>(clock % 256) );
+
 	impl_->pool_.update_threads();
 	impl_->pool_.reduce_histories();
+	impl_->pool_.clear_eval_caches();
 
 	calc_result result;
 
@@ -1468,6 +1762,8 @@ calc_result calc_manager::calc( position const& p, int max_depth, timestamp cons
 	master_worker_thread* master = impl_->pool_.master();
 	master->init( p, sorted, clock, seen, &new_best_cb, start );
 
+	impl_->pool_.start_helpers( l, p, sorted, seen, min_depth, max_depth );
+
 	for( int depth = min_depth; depth <= max_depth && !impl_->do_abort_; ++depth ) {
 
 		master->process( l, depth );
@@ -1521,6 +1817,7 @@ calc_result calc_manager::calc( position const& p, int max_depth, timestamp cons
 	}
 
 	impl_->pool_.wait_for_idle( l );
+	impl_->pool_.stop_helpers( l );
 
 	{
 		move_data const& best = sorted.front();
@@ -1533,6 +1830,15 @@ calc_result calc_manager::calc( position const& p, int max_depth, timestamp cons
 #if USE_STATISTICS
 		timestamp stop;
 		impl_->pool_.stats_.print( impl_->ctx_, stop - start );
+#if USE_STATISTICS >= 2
+		if( impl_->pool_.pawn_tt_size_ ) {
+			std::vector<pawn_structure_hash_table*> pawn_tts;
+			for( auto thread : impl_->pool_.threads_ ) {
+				pawn_tts.push_back( &thread->pawn_tt_ );
+			}
+			impl_->pool_.stats_.print_thread_pawn_stats( pawn_tts );
+		}
+#endif
 		impl_->pool_.stats_.accumulate( stop - start );
 		impl_->pool_.stats_.reset( false );
 #endif
@@ -4,10 +4,12 @@
 #include "config.hpp"
 #include "chess.hpp"
 #include "detect_check.hpp"
+#include "eval_cache.hpp"
 #include "history.hpp"
 #include "phased_move_generator.hpp"
 #include "pvlist.hpp"
 #include "moves.hpp"
+#include "nnue.hpp"
 #include "seen_positions.hpp"
 #include "util.hpp"
 #include "statistics.hpp"
@@ -126,6 +128,7 @@ public:
 		, thread_()
 		, tt_()
 		, pawn_tt_()
+		, eval_cache_()
 	{
 	}
 
@@ -152,12 +155,19 @@ public:
 
 	short quiescence_search( int ply, int depth, position const& p, check_map const& check, short alpha, short beta, short full_eval = result::win );
 
+	// Full evaluation of the position, going through the thread's evaluation cache.
+	short evaluate( position const& p );
+
+	// Needs a push before each apply_move and a pop once done with the new position.
+	nnue::accumulator_stack nnue_;
+
 	bool do_abort_;
 
 	worker_thread* thread_;
 
 	hash* tt_;
 	pawn_structure_hash_table* pawn_tt_;
+	eval_cache* eval_cache_;
 };
 
 #endif
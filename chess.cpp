@@ -23,6 +23,7 @@ contact tim.kosse@filezilla-project.org for details.
 #include "util/logger.hpp"
 #include "magic.hpp"
 #include "moves.hpp"
+#include "nnue.hpp"
 #include "pawn_structure_hash_table.hpp"
 #include "see.hpp"
 #include "statistics.hpp"
@@ -49,8 +50,8 @@ duration const TIME_LIMIT = duration::seconds(900);
 
 void auto_play( context& ctx )
 {
-	ctx.tt_.init( ctx.conf_.memory );
-	ctx.pawn_tt_.init( ctx.conf_.pawn_hash_table_size() );
+	ctx.tt_.init( ctx.conf_ );
+	ctx.pawn_tt_.init( ctx.conf_ );
 	timestamp start;
 	position p;
 
@@ -131,6 +132,7 @@ int main( int argc, char const* argv[] )
 	init_magic();
 	pst.init();
 	eval_values::init();
+	nnue::init( ctx.conf_ );
 
 	init_zobrist_tables();
 
@@ -152,6 +154,20 @@ int main( int argc, char const* argv[] )
 	else if( command == "test" ) {
 		selftest();
 	}
+	else if( command == "bench" ) {
+		bench( ctx );
+	}
+	else if( command == "evalbench" ) {
+		eval_benchmark( ctx );
+	}
+	else if( command == "sliderbench" ) {
+		slider_benchmark();
+	}
+	else if( command == "perftcmp" ) {
+		position p;
+		p.reset();
+		perft_compare( p, (ctx.conf_.max_search_depth() != MAX_DEPTH) ? ctx.conf_.max_search_depth() : 6 );
+	}
 #if DEVELOPMENT
 	else if( command == "tweakgen" ) {
 		generate_test_positions( ctx );
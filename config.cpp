@@ -8,11 +8,19 @@
 
 config::config()
 : thread_count(get_cpu_count()),
+  smp(smp_mode::ybwc),
+  thread_count_given(),
+  memory_given(),
+  numa(),
   memory(get_system_memory() / 3 ),
+  tt_format(hash_format::standard),
   max_moves(0),
   time_limit( duration::hours(1) ),
   ponder(),
   use_book(true),
+  per_thread_pawn_hash(),
+  use_nnue(),
+  perft_hash(),
   fischer_random(),
   depth_(-1)
 {
@@ -81,6 +89,27 @@ std::string config::init( int argc,  char const* argv[] )
 			if( thread_count > get_cpu_count() ) {
 				thread_count = get_cpu_count();
 			}
+			thread_count_given = true;
+		}
+		else if( opt == "--smp" ) {
+			if( ++i >= argc ) {
+				std::cerr << "Missing argument to " << opt << std::endl;
+				exit(1);
+			}
+			std::string const v = argv[i];
+			if( v == "ybwc" ) {
+				smp = smp_mode::ybwc;
+			}
+			else if( v == "lazy" ) {
+				smp = smp_mode::lazy;
+			}
+			else {
+				std::cerr << "Invalid argument to " << opt << std::endl;
+				exit(1);
+			}
+		}
+		else if( opt == "--numa" ) {
+			numa = true;
 		}
 		else if( opt == "--depth" ) {
 			if( ++i >= argc ) {
@@ -105,6 +134,54 @@ std::string config::init( int argc,  char const* argv[] )
 				exit(1);
 			}
 			memory = v;
+			memory_given = true;
+		}
+		else if( opt == "--perft-hash" ) {
+			if( ++i >= argc ) {
+				std::cerr << "Missing argument to " << opt << std::endl;
+				exit(1);
+			}
+			int v = atoi(argv[i]);
+			if( v < 0 ) {
+				std::cerr << "Invalid argument to " << opt << std::endl;
+				exit(1);
+			}
+			perft_hash = v;
+		}
+		else if( opt == "--hash-format" ) {
+			if( ++i >= argc ) {
+				std::cerr << "Missing argument to " << opt << std::endl;
+				exit(1);
+			}
+			std::string const v = argv[i];
+			if( v == "standard" ) {
+				tt_format = hash_format::standard;
+			}
+			else if( v == "dense" ) {
+				tt_format = hash_format::dense;
+			}
+			else {
+				std::cerr << "Invalid argument to " << opt << std::endl;
+				exit(1);
+			}
+		}
+		else if( opt == "--per-thread-pawn-hash" ) {
+			per_thread_pawn_hash = true;
+		}
+		else if( opt == "--shared-hash" ) {
+			if( ++i >= argc ) {
+				std::cerr << "Missing argument to " << opt << std::endl;
+				exit(1);
+			}
+			shared_hash = argv[i];
+		}
+		else if( opt == "--nnue" ) {
+			if( ++i >= argc ) {
+				std::cerr << "Missing argument to " << opt << std::endl;
+				exit(1);
+			}
+			nnue_file = argv[i];
+			use_nnue = true;
 		}
 		else if( opt == "--logfile" ) {
 			if( ++i >= argc ) {
@@ -182,3 +259,12 @@ unsigned int config::pawn_hash_table_size() const
 {
 	return std::min( 64, get_system_memory() / 8 );
 }
+
+
+unsigned int config::per_thread_pawn_hash_table_size() const
+{
+	// Small enough to mostly stay in cache, the working set of pawn
+	// structures of a single thread is not large.
+	unsigned int size = pawn_hash_table_size() / (thread_count ? thread_count : 1);
+	return std::max( 1u, std::min( 4u, size ) );
+}
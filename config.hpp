@@ -17,6 +17,32 @@
 #define DEPTH_FACTOR 6
 #endif
 
+namespace smp_mode {
+enum type {
+	// Young Brothers Wait Concept: Threads split at nodes after the first move has been searched.
+	ybwc,
+
+	// Lazy SMP: Each thread searches independently from the root, sharing only the transposition table.
+	lazy
+};
+}
+
+namespace hash_format {
+enum type {
+	// 4 entries per 64 byte bucket, each 16 bytes. The full key is verified.
+	standard,
+
+	// 5 entries per bucket. An entry is one 64 bit word with the same data
+	// as in the standard format plus the low 13 bits of the full evaluation.
+	// A 32 bit word holds bits 35 to 63 of the key and the upper 3 bits of
+	// the full evaluation. That word is xored with both halves of the first
+	// one for lockless access. Together with the bucket index, at least 45
+	// bits of the key get verified. Tables are at most 32 GiB so that the
+	// bucket index stays below the stored bits.
+	dense
+};
+}
+
 class config
 {
 public:
@@ -26,7 +52,21 @@ public:
 	std::string init( int argc, char const* argv[] );
 
 	unsigned int thread_count;
+	smp_mode::type smp;
+
+	// Whether --threads and --memory were given. Commands with defaults of
+	// their own, like bench, only use thread_count and memory if so.
+	bool thread_count_given;
+	bool memory_given;
+
+	// Pin threads to processors and keep their memory on the local NUMA node.
+	bool numa;
 	unsigned int memory;
+	hash_format::type tt_format;
+
+	// If set, the transposition table lives in the named shared memory
+	// segment, shared with all other processes using the same name.
+	std::string shared_hash;
 	unsigned int max_moves; // only for auto play
 
 	duration time_limit;
@@ -45,6 +85,19 @@ public:
 
 	unsigned int pawn_hash_table_size() const;
 
+	// If set, each search thread gets a small pawn structure hash table of
+	// its own instead of sharing one.
+	bool per_thread_pawn_hash;
+	unsigned int per_thread_pawn_hash_table_size() const;
+
+	// If set, evaluate with the neural network loaded from nnue_file instead
+	// of the hand-crafted evaluation.
+	bool use_nnue;
+	std::string nnue_file;
+
+	// Size in megabytes of the hash table used by perft, 0 to not use one.
+	unsigned int perft_hash;
+
 	bool fischer_random;
 private:
 	void init_self_dir( std::string self );
@@ -375,37 +375,144 @@ bool evaluate_KBBvKN( position const& p, short& result )
 	return false;
 }
 
-bool evaluate_endgame( position const& p, short& result )
+namespace {
+bool evaluate_draw( position const&, short& result )
+{
+	result = result::draw;
+	return true;
+}
+
+// Material and pst difference, damped
+bool evaluate_drawish( position const& p, short& result )
+{
+	result = (p.base_eval.eg() - p.material[0].eg() + p.material[1].eg()) / 5;
+	return true;
+}
+
+template<color::type c>
+bool evaluate_dangerous_for_defender( position const& p, short& result )
+{
+	result = p.base_eval.eg() - p.material[0].eg() + p.material[1].eg() + ((c == color::white) ? 100 : -100);
+	return true;
+}
+
+template<short value>
+bool evaluate_constant( position const&, short& result )
+{
+	result = value;
+	return true;
+}
+
+template<color::type c>
+bool evaluate_KPvK( position const& p, short& result )
+{
+	return evaluate_KPvK( p, c, result );
+}
+
+// Drawn if bishop doesn't control the promotion square and enemy king is on promotion square or next to it
+bool evaluate_KBPvK_white( position const& p, short& result )
+{
+	if( p.bitboards[color::white][bb_type::pawns] & 0x8181818181818181ull ) {
+		uint64_t pawn = bitscan(p.bitboards[color::white][bb_type::pawns]);
+		uint64_t enemy_king_mask = (pawn % 8) ? 0xc0c0000000000000ull : 0x0303000000000000ull;
+		if( enemy_king_mask & p.bitboards[color::black][bb_type::king] ) {
+			bool promotion_square_is_light = (pawn % 8) == 0;
+			bool is_light_squared_bishop = is_light_mask( p.bitboards[color::white][bb_type::bishops] );
+			if( promotion_square_is_light != is_light_squared_bishop ) {
+				result = 0;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool evaluate_KBPvK_black( position const& p, short& result )
+{
+	if( p.bitboards[color::black][bb_type::pawns] & 0x8181818181818181ull ) {
+		uint64_t pawn = bitscan(p.bitboards[color::black][bb_type::pawns]);
+		uint64_t enemy_king_mask = (pawn % 8) ? 0xc0c0ull : 0x0303ull;
+		if( enemy_king_mask & p.bitboards[color::white][bb_type::king] ) {
+			bool promotion_square_is_light = (pawn % 8) == 7;
+			bool is_light_squared_bishop = is_light_mask(p.bitboards[color::black][bb_type::bishops]);
+			if( promotion_square_is_light != is_light_squared_bishop ) {
+				result = 0;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// Easily drawn if opposite colored bishops
+bool evaluate_KBPvKB( position const& p, short& result )
+{
+	bool is_light_squared_white_bishop = is_light_mask(p.bitboards[color::white][bb_type::bishops]);
+	bool is_light_squared_black_bishop = is_light_mask(p.bitboards[color::black][bb_type::bishops]);
+	if( is_light_squared_white_bishop != is_light_squared_black_bishop ) {
+		result = (p.base_eval.eg() - p.material[0].eg() + p.material[1].eg()) / 5;
+		return true;
+	}
+	return false;
+}
+
+bool evaluate_KNBvK_white( position const& p, short& result )
+{
+	result = evaluate_KNBvK( p, color::white );
+	return true;
+}
+
+bool evaluate_KNBvK_black( position const& p, short& result )
 {
-	switch( p.piece_sum ) {
+	result = -evaluate_KNBvK( p, color::black );
+	return true;
+}
+
+template<color::type c>
+bool evaluate_KBPvKP( position const& p, short& result )
+{
+	return evaluate_KBPvKP( p, c, result );
+}
+
+bool evaluate_KPvKP( position const& p, short& result )
+{
+	if( evaluate_KPvKP( p, p.self(), result ) ) {
+		return true;
+	}
+	else {
+		return evaluate_KPvKP( p, p.other(), result );
+	}
+}
+}
+
+
+endgame_function get_endgame_function( uint64_t piece_sum )
+{
+	switch( piece_sum ) {
 	// Totally insufficient material.
 	case 0:
 	case white_knight:
 	case black_knight:
 	case white_bishop:
 	case black_bishop:
-		result = result::draw;
-		return true;
+		return &evaluate_draw;
 
 	// Usually drawn pawnless endgames, equal combinations. Mate only possible if enemy is one epic moron.
 	case white_bishop + black_knight:
 	case white_knight + black_bishop:
 	case white_bishop + black_bishop:
 	case white_knight + black_knight:
-		result = result::draw;
-		return true;
+		return &evaluate_draw;
 
 	// With two knights one cannot force a mate unless enemy is one epic moron.
 	case white_knight * 2:
 	case black_knight * 2:
-		result = result::draw;
-		return true;
+		return &evaluate_draw;
 
 	// Usually drawn pawnless endgames, equal combinations. Still possible to force a mate if enemy loses a piece.
 	case white_queen + black_queen:
 	case white_rook + black_rook:
-		result = (p.base_eval.eg() - p.material[0].eg() + p.material[1].eg()) / 5;
-		return true;
+		return &evaluate_drawish;
 
 	// Usually drawn pawnless endgames, imbalanced combinations.
 	case white_rook + black_bishop:
@@ -420,17 +527,14 @@ bool evaluate_endgame( position const& p, short& result )
 	case 2 * white_knight + black_queen:
 	case white_queen + white_bishop + black_queen:
 	case white_queen + black_bishop + black_queen:
-		result = (p.base_eval.eg() - p.material[0].eg() + p.material[1].eg()) / 5;
-		return true;
+		return &evaluate_drawish;
 	// Drawn but dangerous for the defender.
 	case white_queen + 2 * black_bishop:
 	case white_queen + white_knight + black_queen:
-		result = p.base_eval.eg() - p.material[0].eg() + p.material[1].eg() + 100;
-		return true;
+		return &evaluate_dangerous_for_defender<color::white>;
 	case black_queen + 2 * white_bishop:
 	case white_queen + black_knight + black_queen:
-		result = p.base_eval.eg() - p.material[0].eg() + p.material[1].eg() - 100;
-		return true;
+		return &evaluate_dangerous_for_defender<color::black>;
 
 	// Usually drawn endgames pawn vs. minor piece
 	// If not drawn, search will hopefully save us.
@@ -438,107 +542,66 @@ bool evaluate_endgame( position const& p, short& result )
 	case black_bishop + white_pawn:
 	case white_knight + black_pawn:
 	case black_knight + white_pawn:
-		result = (p.base_eval.eg() - p.material[0].eg() + p.material[1].eg()) / 5;
-		return true;
+		return &evaluate_drawish;
 
 	case white_pawn:
-		return evaluate_KPvK(p, color::white, result);
+		return &evaluate_KPvK<color::white>;
 	case black_pawn:
-		return evaluate_KPvK(p, color::black, result);
-	// Drawn if bishop doesn't control the promotion square and enemy king is on promotion square or next to it
+		return &evaluate_KPvK<color::black>;
 	case white_bishop + white_pawn:
-		if( p.bitboards[color::white][bb_type::pawns] & 0x8181818181818181ull ) {
-			uint64_t pawn = bitscan(p.bitboards[color::white][bb_type::pawns]);
-			uint64_t enemy_king_mask = (pawn % 8) ? 0xc0c0000000000000ull : 0x0303000000000000ull;
-			if( enemy_king_mask & p.bitboards[color::black][bb_type::king] ) {
-				bool promotion_square_is_light = (pawn % 8) == 0;
-				bool is_light_squared_bishop = is_light_mask( p.bitboards[color::white][bb_type::bishops] );
-				if( promotion_square_is_light != is_light_squared_bishop ) {
-					result = 0;
-					return true;
-				}
-			}
-		}
-		break;
+		return &evaluate_KBPvK_white;
 	case black_bishop + black_pawn:
-		if( p.bitboards[color::black][bb_type::pawns] & 0x8181818181818181ull ) {
-			uint64_t pawn = bitscan(p.bitboards[color::black][bb_type::pawns]);
-			uint64_t enemy_king_mask = (pawn % 8) ? 0xc0c0ull : 0x0303ull;
-			if( enemy_king_mask & p.bitboards[color::white][bb_type::king] ) {
-				bool promotion_square_is_light = (pawn % 8) == 7;
-				bool is_light_squared_bishop = is_light_mask(p.bitboards[color::black][bb_type::bishops]);
-				if( promotion_square_is_light != is_light_squared_bishop ) {
-					result = 0;
-					return true;
-				}
-			}
-		}
-		break;
+		return &evaluate_KBPvK_black;
 
-	// Easily drawn if opposite colored bishops
 	case white_bishop + black_bishop + white_pawn:
 	case white_bishop + black_bishop + black_pawn:
-		{
-			bool is_light_squared_white_bishop = is_light_mask(p.bitboards[color::white][bb_type::bishops]);
-			bool is_light_squared_black_bishop = is_light_mask(p.bitboards[color::black][bb_type::bishops]);
-			if( is_light_squared_white_bishop != is_light_squared_black_bishop ) {
-				result = (p.base_eval.eg() - p.material[0].eg() + p.material[1].eg()) / 5;
-				return true;
-			}
-		}
-		break;
+		return &evaluate_KBPvKB;
 	case white_bishop + white_knight:
-		result = evaluate_KNBvK( p, color::white );
-		return true;
+		return &evaluate_KNBvK_white;
 	case black_bishop + black_knight:
-		result = -evaluate_KNBvK( p, color::black );
-		return true;
+		return &evaluate_KNBvK_black;
 	case white_bishop + white_pawn + black_pawn:
-		return evaluate_KBPvKP( p, color::white, result );
+		return &evaluate_KBPvKP<color::white>;
 	case black_bishop + black_pawn + white_pawn:
-		return evaluate_KBPvKP( p, color::black, result );
+		return &evaluate_KBPvKP<color::black>;
 	case white_pawn + black_pawn:
-		if( evaluate_KPvKP( p, p.self(), result ) ) {
-			return true;
-		}
-		else {
-			return evaluate_KPvKP( p, p.other(), result );
-		}
+		return &evaluate_KPvKP;
 	case white_rook + black_rook + white_pawn:
-		return evaluate_KRPvKR<color::white>( p, result );
+		return &evaluate_KRPvKR<color::white>;
 	case white_rook + black_rook + black_pawn:
-		return evaluate_KRPvKR<color::black>( p, result );
+		return &evaluate_KRPvKR<color::black>;
 	case white_bishop + white_pawn + black_knight:
-		return evaluate_KBPvKN<color::white>( p, result );
+		return &evaluate_KBPvKN<color::white>;
 	case black_bishop + black_pawn + white_knight:
-		return evaluate_KBPvKN<color::black>( p, result );
+		return &evaluate_KBPvKN<color::black>;
 
 	// Good as draw
 	case 2 * white_bishop + black_bishop:
-		result = 2;
-		return true;
+		return &evaluate_constant<2>;
 	case 2 * black_bishop + white_bishop:
-		result = -2;
-		return true;
+		return &evaluate_constant<-2>;
 	case 2 * white_bishop + black_bishop + black_pawn:
-		result = 1;
-		return true;
+		return &evaluate_constant<1>;
 	case 2 * black_bishop + white_bishop + white_pawn:
-		result = -1;
-		return true;
+		return &evaluate_constant<-1>;
 
 	// Drawn if both bishops are of same color
 	case 2 * white_bishop:
-		return evaluate_KBBvK<color::white>( p, result );
+		return &evaluate_KBBvK<color::white>;
 	case 2 * black_bishop:
-		return evaluate_KBBvK<color::black>( p, result );
+		return &evaluate_KBBvK<color::black>;
 	case 2 * white_bishop + black_knight:
-		return evaluate_KBBvKN<color::white>( p, result );
+		return &evaluate_KBBvKN<color::white>;
 	case 2 * black_bishop + white_knight:
-		return evaluate_KBBvKN<color::black>( p, result );
+		return &evaluate_KBBvKN<color::black>;
 	default:
-		break;
+		return 0;
 	}
+}
 
-	return false;
+
+bool evaluate_endgame( position const& p, short& result )
+{
+	endgame_function f = get_endgame_function( p.piece_sum );
+	return f && f( p, result );
 }
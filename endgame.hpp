@@ -3,6 +3,15 @@
 
 #include "chess.hpp"
 
+// Specialized evaluation of a material configuration. Returns false if the
+// normal evaluation is to be used instead, otherwise result is from white's
+// point of view.
+typedef bool (*endgame_function)( position const& p, short& result );
+
+// Returns the specialized evaluation for the given position::piece_sum, 0 if
+// there is none.
+endgame_function get_endgame_function( uint64_t piece_sum );
+
 bool evaluate_endgame( position const& p, short& result );
 
 #endif
@@ -102,8 +102,8 @@ int run_sts( context& ctx, epd const& e, int& match, int& sum )
 			scores[m] = move_score;
 		}
 
-		ctx.tt_.init( ctx.conf_.memory, true );
-		ctx.pawn_tt_.init( ctx.conf_.pawn_hash_table_size(), true );
+		ctx.tt_.init( ctx.conf_, true );
+		ctx.pawn_tt_.init( ctx.conf_, true );
 
 		calc_manager c(ctx);
 		seen_positions seen( e.p.hash_ );
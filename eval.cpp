@@ -4,6 +4,8 @@
 #include "assert.hpp"
 #include "fen.hpp"
 #include "magic.hpp"
+#include "material_table.hpp"
+#include "nnue.hpp"
 #include "pawn_structure_hash_table.hpp"
 #include "util.hpp"
 #include "statistics.hpp"
@@ -13,6 +15,8 @@
 #include <iostream>
 #include <sstream>
 
+int const eval_version = 9;
+
 namespace eval_detail {
 enum type {
 	material,
@@ -152,8 +156,10 @@ namespace {
 
 uint64_t const central_squares[2] = { 0x000000003c3c3c00ull, 0x003c3c3c00000000ull };
 
-template<bool detail>
-inline static void evaluate_pawns_mobility( position const& p, color::type c, eval_results& results )
+// The color is a template parameter so that table rows, pawn directions and
+// relative ranks are resolved at compile time, once per side.
+template<bool detail, color::type c>
+inline static void evaluate_pawns_mobility( position const& p, eval_results& results )
 {
 	uint64_t pawns = p.bitboards[c][bb_type::pawns];
 
@@ -173,8 +179,8 @@ inline static void evaluate_pawns_mobility( position const& p, color::type c, ev
 	}
 }
 
-template<bool detail>
-inline static void evaluate_knight_mobility( position const& p, color::type c, uint64_t knight, eval_results& results )
+template<bool detail, color::type c>
+inline static void evaluate_knight_mobility( position const& p, uint64_t knight, eval_results& results )
 {
 	uint64_t moves = possible_knight_moves[knight];
 
@@ -202,8 +208,8 @@ short const outpost_squares[64] = {
 };
 
 
-template<bool detail>
-inline static void evaluate_knight_outpost( position const& p, color::type c, uint64_t knight, eval_results& results )
+template<bool detail, color::type c>
+inline static void evaluate_knight_outpost( position const& p, uint64_t knight, eval_results& results )
 {
 	if( outpost_squares[knight] && !(p.bitboards[other(c)][bb_type::pawns] & forward_pawn_attack[c][knight] ) ) {
 		// We're in a sunny outpost. Check whether theres a pawn to cover us
@@ -217,8 +223,8 @@ inline static void evaluate_knight_outpost( position const& p, color::type c, ui
 }
 
 
-template<bool detail>
-inline static void evaluate_knights( position const& p, color::type c, eval_results& results )
+template<bool detail, color::type c>
+inline static void evaluate_knights( position const& p, eval_results& results )
 {
 	uint64_t knights = p.bitboards[c][bb_type::knights];
 
@@ -227,15 +233,15 @@ inline static void evaluate_knights( position const& p, color::type c, eval_resu
 
 		add_score<detail, eval_detail::king_tropism>( results, c, eval_values::tropism[pieces::knight] * (4 - king_distance[knight][p.king_pos[other(c)]]) );
 
-		evaluate_knight_mobility<detail>( p, c, knight, results );
-		evaluate_knight_outpost<detail>( p, c, knight, results );
+		evaluate_knight_mobility<detail, c>( p, knight, results );
+		evaluate_knight_outpost<detail, c>( p, knight, results );
 	}
 
 }
 
 
-template<bool detail>
-inline static void evaluate_bishop_mobility( position const& p, color::type c, uint64_t bishop, eval_results& results )
+template<bool detail, color::type c>
+inline static void evaluate_bishop_mobility( position const& p, uint64_t bishop, eval_results& results )
 {
 	uint64_t const all_blockers = (p.bitboards[other(c)][bb_type::all_pieces] | p.bitboards[c][bb_type::all_pieces]) & ~p.bitboards[c][bb_type::queens];
 
@@ -253,25 +259,28 @@ inline static void evaluate_bishop_mobility( position const& p, color::type c, u
 }
 
 
-template<bool detail>
-inline static void evaluate_bishop_pin( position const& p, color::type c, uint64_t bishop, eval_results& results )
+template<bool detail, color::type c>
+inline static void evaluate_bishop_pin( position const& p, uint64_t bishop, eval_results& results )
 {
+	// Cheap test first, the slider lookup is only needed if there is exactly
+	// one enemy piece on the line to the king.
+	uint64_t between = between_squares[bishop][p.king_pos[other(c)]] & p.bitboards[other(c)][bb_type::all_pieces];
+	if( popcount( between ) != 1 ) {
+		return;
+	}
+
 	uint64_t own_blockers = p.bitboards[c][bb_type::all_pieces];
 	uint64_t unblocked_moves = bishop_magic( bishop, own_blockers );
 
 	if( unblocked_moves & p.bitboards[other(c)][bb_type::king] ) {
-
-		uint64_t between = between_squares[bishop][p.king_pos[other(c)]] & p.bitboards[other(c)][bb_type::all_pieces];
-		if( popcount( between ) == 1 ) {
-			pieces::type piece = p.get_piece( bitscan( between ) );
-			add_score<detail, eval_detail::absolute_pins>( results, c, eval_values::absolute_pin[ piece ] );
-		}
+		pieces::type piece = p.get_piece( bitscan( between ) );
+		add_score<detail, eval_detail::absolute_pins>( results, c, eval_values::absolute_pin[ piece ] );
 	}
 }
 
 
-template<bool detail>
-inline static void evaluate_bishop_outpost( position const& p, color::type c, uint64_t bishop, eval_results& results )
+template<bool detail, color::type c>
+inline static void evaluate_bishop_outpost( position const& p, uint64_t bishop, eval_results& results )
 {
 	if( outpost_squares[bishop] && !(p.bitboards[other(c)][bb_type::pawns] & forward_pawn_attack[c][bishop] ) ) {
 		// We're in a sunny outpost. Check whether theres a pawn to cover us
@@ -285,8 +294,8 @@ inline static void evaluate_bishop_outpost( position const& p, color::type c, ui
 }
 
 
-template<bool detail>
-inline static void evaluate_bishops( position const& p, color::type c, eval_results& results )
+template<bool detail, color::type c>
+inline static void evaluate_bishops( position const& p, eval_results& results )
 {
 	uint64_t bishops = p.bitboards[c][bb_type::bishops];
 
@@ -295,15 +304,15 @@ inline static void evaluate_bishops( position const& p, color::type c, eval_resu
 
 		add_score<detail, eval_detail::king_tropism>( results, c, eval_values::tropism[pieces::bishop] * (4 - king_distance[bishop][p.king_pos[other(c)]]) );
 
-		evaluate_bishop_mobility<detail>( p, c, bishop, results );
-		evaluate_bishop_pin<detail>( p, c, bishop, results );
-		evaluate_bishop_outpost<detail>( p, c, bishop, results );
+		evaluate_bishop_mobility<detail, c>( p, bishop, results );
+		evaluate_bishop_pin<detail, c>( p, bishop, results );
+		evaluate_bishop_outpost<detail, c>( p, bishop, results );
 	}
 }
 
 
-template<bool detail>
-inline static void evaluate_rook_trapped( position const& p, color::type c, uint64_t rook, eval_results& results )
+template<bool detail, color::type c>
+inline static void evaluate_rook_trapped( position const& p, uint64_t rook, eval_results& results )
 {
 	// In middle-game, a rook trapped behind own pawns on the same side of a king that cannot castle is quite bad.
 	// Getting that rook into play likely requires several tempi and/or might destroy structur of own position.
@@ -339,8 +348,8 @@ inline static void evaluate_rook_trapped( position const& p, color::type c, uint
 }
 
 
-template<bool detail>
-inline static void evaluate_rook_mobility( position const& p, color::type c, uint64_t rook, eval_results& results )
+template<bool detail, color::type c>
+inline static void evaluate_rook_mobility( position const& p, uint64_t rook, eval_results& results )
 {
 	uint64_t const all_blockers = (p.bitboards[other(c)][bb_type::all_pieces] | p.bitboards[c][bb_type::all_pieces]) & ~(p.bitboards[c][bb_type::rooks] | p.bitboards[c][bb_type::queens]);
 
@@ -364,30 +373,32 @@ inline static void evaluate_rook_mobility( position const& p, color::type c, uin
 	add_score<detail, eval_detail::mobility>( results, c, eval_values::mobility[pieces::rook][move_count] );
 
 	if( move_count < 4 ) {
-		evaluate_rook_trapped<detail>( p, c, rook, results );
+		evaluate_rook_trapped<detail, c>( p, rook, results );
 	}
 }
 
 
-template<bool detail>
-inline static void evaluate_rook_pin( position const& p, color::type c, uint64_t rook, eval_results& results )
+template<bool detail, color::type c>
+inline static void evaluate_rook_pin( position const& p, uint64_t rook, eval_results& results )
 {
+	// See evaluate_bishop_pin
+	uint64_t between = between_squares[rook][p.king_pos[other(c)]] & p.bitboards[other(c)][bb_type::all_pieces];
+	if( popcount( between ) != 1 ) {
+		return;
+	}
+
 	uint64_t own_blockers = p.bitboards[c][bb_type::all_pieces];
 	uint64_t unblocked_moves = rook_magic( rook, own_blockers );
 
 	if( unblocked_moves & p.bitboards[other(c)][bb_type::king] ) {
-
-		uint64_t between = between_squares[rook][p.king_pos[other(c)]] & p.bitboards[other(c)][bb_type::all_pieces];
-		if( popcount( between ) == 1 ) {
-			pieces::type piece = p.get_piece( bitscan( between ) );
-			add_score<detail, eval_detail::absolute_pins>( results, c, eval_values::absolute_pin[ piece ] );
-		}
+		pieces::type piece = p.get_piece( bitscan( between ) );
+		add_score<detail, eval_detail::absolute_pins>( results, c, eval_values::absolute_pin[ piece ] );
 	}
 }
 
 
-template<bool detail>
-inline static void evaluate_rook_on_open_file( position const& p, color::type c, uint64_t rook, eval_results& results )
+template<bool detail, color::type c>
+inline static void evaluate_rook_on_open_file( position const& p, uint64_t rook, eval_results& results )
 {
 	uint64_t file = 0x0101010101010101ull << (rook % 8);
 	if( !(p.bitboards[c][bb_type::pawns] & file) ) {
@@ -404,8 +415,8 @@ inline static void evaluate_rook_on_open_file( position const& p, color::type c,
 uint64_t const trapped_king[2]   = { 0x00000000000000ffull, 0xff00000000000000ull };
 uint64_t const trapping_piece[2] = { 0x00ff000000000000ull, 0x000000000000ff00ull };
 
-template<bool detail>
-inline static void evaluate_rooks( position const& p, color::type c, eval_results& results )
+template<bool detail, color::type c>
+inline static void evaluate_rooks( position const& p, eval_results& results )
 {
 	uint64_t rooks = p.bitboards[c][bb_type::rooks];
 
@@ -414,9 +425,9 @@ inline static void evaluate_rooks( position const& p, color::type c, eval_result
 
 		add_score<detail, eval_detail::king_tropism>( results, c, eval_values::tropism[pieces::rook] * (4 - king_distance[rook][p.king_pos[other(c)]]) );
 
-		evaluate_rook_mobility<detail>( p, c, rook, results);
-		evaluate_rook_pin<detail>( p, c, rook, results );
-		evaluate_rook_on_open_file<detail>( p, c, rook, results );
+		evaluate_rook_mobility<detail, c>( p, rook, results);
+		evaluate_rook_pin<detail, c>( p, rook, results );
+		evaluate_rook_on_open_file<detail, c>( p, rook, results );
 	}
 
 	// At least in endgame, enemy king trapped on its home rank is quite useful.
@@ -426,8 +437,8 @@ inline static void evaluate_rooks( position const& p, color::type c, eval_result
 }
 
 
-template<bool detail>
-inline static void evaluate_queen_mobility( position const& p, color::type c, uint64_t queen, eval_results& results )
+template<bool detail, color::type c>
+inline static void evaluate_queen_mobility( position const& p, uint64_t queen, eval_results& results )
 {
 	uint64_t const all_blockers = p.bitboards[other(c)][bb_type::all_pieces] | p.bitboards[c][bb_type::all_pieces];
 
@@ -445,25 +456,27 @@ inline static void evaluate_queen_mobility( position const& p, color::type c, ui
 }
 
 
-template<bool detail>
-inline static void evaluate_queen_pin( position const& p, color::type c, uint64_t queen, eval_results& results )
+template<bool detail, color::type c>
+inline static void evaluate_queen_pin( position const& p, uint64_t queen, eval_results& results )
 {
+	// See evaluate_bishop_pin
+	uint64_t between = between_squares[queen][p.king_pos[other(c)]] & p.bitboards[other(c)][bb_type::all_pieces];
+	if( popcount( between ) != 1 ) {
+		return;
+	}
+
 	uint64_t own_blockers = p.bitboards[c][bb_type::all_pieces];
 	uint64_t unblocked_moves = bishop_magic( queen, own_blockers ) | rook_magic( queen, own_blockers );
 
 	if( unblocked_moves & p.bitboards[other(c)][bb_type::king] ) {
-
-		uint64_t between = between_squares[queen][p.king_pos[other(c)]] & p.bitboards[other(c)][bb_type::all_pieces];
-		if( popcount( between ) == 1 ) {
-			pieces::type piece = p.get_piece( bitscan( between ) );
-			add_score<detail, eval_detail::absolute_pins>( results, c, eval_values::absolute_pin[ piece ] );
-		}
+		pieces::type piece = p.get_piece( bitscan( between ) );
+		add_score<detail, eval_detail::absolute_pins>( results, c, eval_values::absolute_pin[ piece ] );
 	}
 }
 
 
-template<bool detail>
-inline static void evaluate_queens( position const& p, color::type c, eval_results& results )
+template<bool detail, color::type c>
+inline static void evaluate_queens( position const& p, eval_results& results )
 {
 	uint64_t queens = p.bitboards[c][bb_type::queens];
 
@@ -472,16 +485,16 @@ inline static void evaluate_queens( position const& p, color::type c, eval_resul
 
 		add_score<detail, eval_detail::king_tropism>( results, c, eval_values::tropism[pieces::queen] * (4 - king_distance[queen][p.king_pos[other(c)]]) );
 
-		evaluate_queen_mobility<detail>( p, c, queen, results );
-		evaluate_queen_pin<detail>( p, c, queen, results );
+		evaluate_queen_mobility<detail, c>( p, queen, results );
+		evaluate_queen_pin<detail, c>( p, queen, results );
 	}
 }
 
 
 short advance_bonus[] = { 1, 1, 1, 2, 4, 8 };
 
-template<bool detail>
-void evaluate_passed_pawns( position const& p, color::type c, eval_results& results )
+template<bool detail, color::type c>
+void evaluate_passed_pawns( position const& p, eval_results& results )
 {
 	uint64_t passed = (p.bitboards[c][bb_type::pawns] & results.passed_pawns );
 	uint64_t unstoppable = passed & ~rule_of_the_square[other(c)][p.c][p.king_pos[other(c)]];
@@ -519,8 +532,8 @@ uint64_t const base_king_attack[2][8] = {
 };
 
 
-template<bool detail>
-static void evaluate_king_attack( position const& p, color::type c, eval_results& results )
+template<bool detail, color::type c>
+static void evaluate_king_attack( position const& p, eval_results& results )
 {
 	// Consider a lone attacker harmless
 	if( results.count_king_attackers[c] < 2 ||
@@ -580,7 +593,8 @@ static void evaluate_king_attack( position const& p, color::type c, eval_results
 }
 
 
-void evaluate_pawn( uint64_t own_pawns, uint64_t foreign_pawns, color::type c, uint64_t pawn, eval_results& results, score* s )
+template<color::type c>
+void evaluate_pawn( uint64_t own_pawns, uint64_t foreign_pawns, uint64_t pawn, eval_results& results, score* s )
 {
 	uint64_t file = pawn % 8;
 
@@ -667,8 +681,8 @@ void evaluate_pawn( uint64_t own_pawns, uint64_t foreign_pawns, color::type c, u
 
 
 
-template<bool detail>
-void do_evaluate_pawns( position const& p, color::type c, eval_results& results, score* s )
+template<bool detail, color::type c>
+void do_evaluate_pawns( position const& p, eval_results& results, score* s )
 {
 	uint64_t own_pawns = p.bitboards[c][bb_type::pawns];
 	uint64_t foreign_pawns = p.bitboards[other(c)][bb_type::pawns];
@@ -676,16 +690,15 @@ void do_evaluate_pawns( position const& p, color::type c, eval_results& results,
 	uint64_t pawns = own_pawns;
 	while( pawns ) {
 		uint64_t pawn = bitscan_unset( pawns );
-		evaluate_pawn( own_pawns, foreign_pawns, c, pawn, results, s );
+		evaluate_pawn<c>( own_pawns, foreign_pawns, pawn, results, s );
 	}
 }
 
 template<bool detail>
 void do_evaluate_pawns( position const& p, eval_results& results, score* s )
 {
-	for( int c = 0; c < 2; ++c ) {
-		do_evaluate_pawns<detail>( p, static_cast<color::type>(c), results, s );
-	}
+	do_evaluate_pawns<detail, color::white>( p, results, s );
+	do_evaluate_pawns<detail, color::black>( p, results, s );
 }
 
 template<bool detail>
@@ -718,7 +731,9 @@ void evaluate_pawns( pawn_structure_hash_table& pawn_tt, position const& p, eval
  * Idea is that pawns closer to king score more than pawns away from king. Also,
  * for a good score, king needs to be on home rank.
  */
-score evaluate_pawn_shield( position const& p, color::type c )
+namespace {
+template<color::type c>
+score evaluate_pawn_shield( position const& p )
 {
 	int king_pos = p.king_pos[c];
 	if( c ? king_pos < 24 : king_pos >= 40 ) {
@@ -745,12 +760,18 @@ score evaluate_pawn_shield( position const& p, color::type c )
 	return s;
 }
 
+}
+
+score evaluate_pawn_shield( position const& p, color::type c )
+{
+	return c ? evaluate_pawn_shield<color::black>( p ) : evaluate_pawn_shield<color::white>( p );
+}
 
 namespace {
-template<bool detail>
-void evaluate_pawn_shield_side( position const& p, color::type c, eval_results& results )
+template<bool detail, color::type c>
+void evaluate_pawn_shield_side( position const& p, eval_results& results )
 {
-	score s = evaluate_pawn_shield( p, c );
+	score s = evaluate_pawn_shield<c>( p );
 	add_score<detail, eval_detail::pawn_shield>( results, c, s );
 	results.pawn_shield[c] = s.mg();
 }
@@ -759,13 +780,13 @@ void evaluate_pawn_shield_side( position const& p, color::type c, eval_results&
 template<bool detail>
 void evaluate_pawn_shields( position const& p, eval_results& results )
 {
-	evaluate_pawn_shield_side<detail>( p, color::white, results );
-	evaluate_pawn_shield_side<detail>( p, color::black, results );
+	evaluate_pawn_shield_side<detail, color::white>( p, results );
+	evaluate_pawn_shield_side<detail, color::black>( p, results );
 }
 
 
-template<bool detail>
-static void evaluate_center( position const& p, color::type c, eval_results& results )
+template<bool detail, color::type c>
+static void evaluate_center( position const& p, eval_results& results )
 {
 	// Not taken by own pawns nor under control by enemy pawns
 	uint64_t potential_center_squares = central_squares[c] & ~(p.bitboards[c][bb_type::pawns] | p.bitboards[other(c)][bb_type::pawn_control]);
@@ -774,73 +795,29 @@ static void evaluate_center( position const& p, color::type c, eval_results& res
 	add_score<detail, eval_detail::center_control>( results, c, eval_values::center_control * static_cast<short>(popcount(safe_center_squares)) );
 }
 
-template<bool detail>
-static void evaluate_piece_defense( position const& p, color::type c, eval_results& results )
+template<bool detail, color::type c>
+static void evaluate_piece_defense( position const& p, eval_results& results )
 {
 	// Bonus for enemy pieces we attack that are not defended
 	// Undefended are those attacked by self, not attacked by enemy
 	uint64_t undefended = results.attacks[c][pieces::none] & ~results.attacks[other(c)][pieces::none];
 	uint64_t defended = results.attacks[c][pieces::none] & results.attacks[other(c)][pieces::none];
 	for( unsigned int piece = 1; piece < 6; ++piece ) {
-		add_score<detail, eval_detail::hanging_pieces>( results, static_cast<color::type>(c), eval_values::hanging_piece[piece] * static_cast<short>(popcount( p.bitboards[other(c)][piece] & undefended) ) );
-		add_score<detail, eval_detail::attacked_pieces>( results, static_cast<color::type>(c), eval_values::attacked_piece[piece] * static_cast<short>(popcount( p.bitboards[other(c)][piece] & defended) ) );
-		add_score<detail, eval_detail::defended_by_pawn>( results, static_cast<color::type>(c), eval_values::defended_by_pawn[piece] * static_cast<short>(popcount( p.bitboards[c][piece] & p.bitboards[c][bb_type::pawn_control]) ) );
+		add_score<detail, eval_detail::hanging_pieces>( results, c, eval_values::hanging_piece[piece] * static_cast<short>(popcount( p.bitboards[other(c)][piece] & undefended) ) );
+		add_score<detail, eval_detail::attacked_pieces>( results, c, eval_values::attacked_piece[piece] * static_cast<short>(popcount( p.bitboards[other(c)][piece] & defended) ) );
+		add_score<detail, eval_detail::defended_by_pawn>( results, c, eval_values::defended_by_pawn[piece] * static_cast<short>(popcount( p.bitboards[c][piece] & p.bitboards[c][bb_type::pawn_control]) ) );
 	}
 }
 
-template<bool detail>
-static void evaluate_imbalance( position const& p, eval_results& results )
-{
-	// TODO: Check if it's faster to use p.piece_sum
-	short pawns[2];
-	pawns[0] = static_cast<short>( popcount( p.bitboards[0][bb_type::pawns] ) );
-	pawns[1] = static_cast<short>( popcount( p.bitboards[1][bb_type::pawns] ) );
-	short pawn_diff = pawns[0] - pawns[1];
-
-	short minors[2];
-	minors[0] = static_cast<short>( popcount( p.bitboards[0][bb_type::knights] | p.bitboards[0][bb_type::bishops] ) );
-	minors[1] = static_cast<short>( popcount( p.bitboards[1][bb_type::knights] | p.bitboards[1][bb_type::bishops] ) );
-	short minor_diff = minors[0] - minors[1];
-
-	// TODO: Somehow handle queens
-	short majors[2];
-	majors[0] = static_cast<short>( popcount( p.bitboards[0][bb_type::rooks] ) );
-	majors[1] = static_cast<short>( popcount( p.bitboards[1][bb_type::rooks] )) ;
-	short major_diff = majors[0] - majors[1];
-
-	score v;
-	while( minor_diff > 1 && major_diff < 0 ) {
-		v += eval_values::material_imbalance[1];
-		minor_diff -= 2;
-		++major_diff;
-	}
-	while( minor_diff < -1 && major_diff > 0 ) {
-		v -= eval_values::material_imbalance[1];
-		minor_diff += 2;
-		--major_diff;
-	}
-	while( pawn_diff > 2 && minor_diff < 0 ) {
-		pawn_diff -= 3;
-		++minor_diff;
-	}
-	while( pawn_diff < -2 && minor_diff > 0 ) {
-		pawn_diff += 3;
-		--minor_diff;
-	}
-	v += eval_values::material_imbalance[0] * minor_diff;
-
-	add_score<detail, eval_detail::imbalance>( results, color::white, v );
-}
-
-template<bool detail>
-static void evaluate_pieces( position const& p, color::type c, eval_results& results )
+template<bool detail, color::type c>
+static void evaluate_pieces( position const& p, eval_results& results )
 {
 	results.attacks[c][pieces::pawn] = p.bitboards[c][bb_type::pawn_control];
-	evaluate_pawns_mobility<detail>( p, c, results );
-	evaluate_knights<detail>( p, c, results );
-	evaluate_bishops<detail>( p, c, results );
-	evaluate_rooks<detail>( p, c, results );
-	evaluate_queens<detail>( p, c, results );
+	evaluate_pawns_mobility<detail, c>( p, results );
+	evaluate_knights<detail, c>( p, results );
+	evaluate_bishops<detail, c>( p, results );
+	evaluate_rooks<detail, c>( p, results );
+	evaluate_queens<detail, c>( p, results );
 
 	//Piece-square tables already contain this
 	//results.center_control += static_cast<short>(popcount(p.bitboards[c][bb_type::all_pieces] & center_squares));
@@ -855,7 +832,7 @@ static void evaluate_pieces( position const& p, color::type c, eval_results& res
 }
 
 template<bool detail>
-static void do_evaluate( pawn_structure_hash_table& pawn_tt, position const& p, eval_results& results )
+static void do_evaluate( pawn_structure_hash_table& pawn_tt, position const& p, material_entry const& material, eval_results& results )
 {
 	evaluate_pawns<detail>( pawn_tt, p, results );
 
@@ -865,22 +842,25 @@ static void do_evaluate( pawn_structure_hash_table& pawn_tt, position const& p,
 		}
 	}
 
-	evaluate_imbalance<detail>( p, results );
+	add_score<detail, eval_detail::imbalance>( results, color::white, material.imbalance );
 
 	evaluate_pawn_shields<detail>( p, results );
 
 	add_score<detail, eval_detail::side_to_move>( results, p.self(), eval_values::side_to_move );
 
-	for( unsigned int c = 0; c < 2; ++c ) {
-		evaluate_pieces<detail>( p, static_cast<color::type>(c), results );
-	}
+	evaluate_pieces<detail, color::white>( p, results );
+	evaluate_pieces<detail, color::black>( p, results );
 
-	for( unsigned int c = 0; c < 2; ++c ) {
-		evaluate_piece_defense<detail>( p, static_cast<color::type>(c), results );
-		evaluate_king_attack<detail>( p, static_cast<color::type>(c), results );
-		evaluate_center<detail>( p, static_cast<color::type>(c), results );
-		evaluate_passed_pawns<detail>( p, static_cast<color::type>(c), results );
-	}
+	// Both sides' attacks need to be known from here on
+	evaluate_piece_defense<detail, color::white>( p, results );
+	evaluate_king_attack<detail, color::white>( p, results );
+	evaluate_center<detail, color::white>( p, results );
+	evaluate_passed_pawns<detail, color::white>( p, results );
+
+	evaluate_piece_defense<detail, color::black>( p, results );
+	evaluate_king_attack<detail, color::black>( p, results );
+	evaluate_center<detail, color::black>( p, results );
+	evaluate_passed_pawns<detail, color::black>( p, results );
 }
 
 score sum_up( position const& p, eval_results const& results ) {
@@ -889,12 +869,10 @@ score sum_up( position const& p, eval_results const& results ) {
 }
 
 namespace {
-static void scale_by_material( position const& p, short& ev )
+// See material_table::compute for the reasoning
+static void scale_by_material( position const& p, material_entry const& material, short& ev )
 {
-	// Check for endgames with opposite colored bishops, those are rather drawish :(
-	if( p.material[0].mg() == eval_values::material_values[pieces::bishop].mg() &&
-		p.material[1].mg() == eval_values::material_values[pieces::bishop].mg() )
-	{
+	if( material.opposite_bishops ) {
 		bool white_is_light = is_light_mask( p.bitboards[0][bb_type::bishops] );
 		bool black_is_light = is_light_mask( p.bitboards[1][bb_type::bishops] );
 		if( white_is_light != black_is_light ) {
@@ -902,35 +880,25 @@ static void scale_by_material( position const& p, short& ev )
 		}
 	}
 
-	// If we're pawnless, an advantage of a single bishop or less is usually not enough to force a win.
-	//
-	// "You can tune Pawn values until doomsday, but you will never get anything that is remotely as good
-	//  as just dividing the score by (a completely guessed) two if the leading side has no Pawns." (H.G. Muller)
 	color::type c = (ev > 0) ? color::white : color::black;
-	if( !p.bitboards[c][bb_type::pawns] ) {
-		// Check material difference, assume that weaker side would just exchange material
-		if( (p.material[c].mg() - p.material[other(c)].mg()) <= eval_values::material_values[pieces::bishop].mg() ) {
-			if( p.material[c].mg() <= eval_values::material_values[pieces::bishop].mg() ) {
-				// We don't even have enough material to force a win if opponent has nothing. Draw at best.
-				ev = 0;
-			}
-			else {
-				ev /= 2;
-			}
-		}
-	}
+	ev = ev * material.scale[c] / 2;
 }
 
-static short scale( position const& p, score const& s )
+static short scale( position const& p, material_entry const& material, score const& s )
 {
 	short mat = p.material[0].mg() + p.material[1].mg();
 	short ev = s.scale( mat );
 
-	scale_by_material( p, ev );
+	scale_by_material( p, material, ev );
 
 	return ev;
 }
 
+static short scale( position const& p, score const& s )
+{
+	return scale( p, material_table::probe( p.piece_sum ), s );
+}
+
 
 static std::string explain( position const& p, const char* name, score const& data ) {
 	std::stringstream ss;
@@ -972,8 +940,10 @@ std::string explain_eval( pawn_structure_hash_table& pawn_tt, position const& p
 {
 	std::stringstream ss;
 
+	material_entry const material = material_table::probe( p.piece_sum );
+
 	short endgame = 0;
-	if( evaluate_endgame( p, endgame ) ) {
+	if( material.endgame && material.endgame( p, endgame ) ) {
 		ss << "Endgame: " << endgame << std::endl;
 	}
 	else {
@@ -983,7 +953,7 @@ std::string explain_eval( pawn_structure_hash_table& pawn_tt, position const& p
 		}
 
 		eval_results results;
-		do_evaluate<true>( pawn_tt, p, results );
+		do_evaluate<true>( pawn_tt, p, material, results );
 
 		score full = sum_up( p, results );
 
@@ -1031,8 +1001,14 @@ std::string explain_eval( pawn_structure_hash_table& pawn_tt, position const& p
 
 short evaluate_full( pawn_structure_hash_table& pawn_tt, position const& p )
 {
+	if( nnue::enabled() ) {
+		return nnue::evaluate( p );
+	}
+
+	material_entry const material = material_table::probe( p.piece_sum );
+
 	short eval = 0;
-	if( evaluate_endgame( p, eval ) ) {
+	if( material.endgame && material.endgame( p, eval ) ) {
 		if( !p.white() ) {
 			eval = -eval;
 		}
@@ -1047,11 +1023,11 @@ short evaluate_full( pawn_structure_hash_table& pawn_tt, position const& p )
 #endif
 
 	eval_results results;
-	do_evaluate<false>( pawn_tt, p, results );
+	do_evaluate<false>( pawn_tt, p, material, results );
 
 	score full = sum_up( p, results );
 
-	eval = scale( p, full );
+	eval = scale( p, material, full );
 	if( !p.white() ) {
 		eval = -eval;
 	}
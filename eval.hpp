@@ -4,6 +4,10 @@
 #include "chess.hpp"
 #include "score.hpp"
 
+// Bump whenever evaluation changes. Stored scores with a different version
+// are considered stale.
+extern int const eval_version;
+
 short evaluate_full( pawn_structure_hash_table& pawn_tt, position const& p );
 
 std::string explain_eval( pawn_structure_hash_table& pawn_tt, position const& p );
@@ -0,0 +1,39 @@
+#include "eval_cache.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+// 128 KiB, small enough to mostly stay in the level 2 cache.
+uint64_t const entry_count = 16 * 1024;
+}
+
+
+eval_cache::eval_cache()
+	: data_()
+	, mask_(entry_count - 1)
+{
+	data_ = reinterpret_cast<uint64_t*>(page_aligned_malloc( size() ));
+	if( !data_ ) {
+		abort();
+	}
+	clear();
+}
+
+
+eval_cache::~eval_cache()
+{
+	aligned_free( data_ );
+}
+
+
+void eval_cache::clear()
+{
+	memset( data_, 0, size() );
+}
+
+
+uint64_t eval_cache::size() const
+{
+	return entry_count * sizeof(uint64_t);
+}
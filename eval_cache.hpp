@@ -0,0 +1,48 @@
+#ifndef __EVAL_CACHE_H__
+#define __EVAL_CACHE_H__
+
+#include "util/platform.hpp"
+
+/*
+ * Small cache of static evaluations, keyed by the zobrist hash of the
+ * position. Each search thread owns one, so it stays in the thread's caches
+ * and needs no synchronization at all.
+ *
+ * Keeps evaluation-only results out of the transposition table, where they
+ * would compete with real search results for the bucket slots.
+ *
+ * Each entry is a single 64bit word: The upper 48 bits of the key and the
+ * 16bit evaluation. The lower bits of the key select the entry.
+ */
+class eval_cache
+{
+public:
+	eval_cache();
+	~eval_cache();
+
+	// Needs to be called if the evaluation values change.
+	void clear();
+
+	// Table memory, e.g. for binding it to a NUMA node.
+	void* data() const { return data_; }
+	uint64_t size() const;
+
+	bool lookup( uint64_t key, short& eval ) const {
+		uint64_t const v = data_[key & mask_];
+		if( (v ^ key) & ~uint64_t(0xffff) ) {
+			return false;
+		}
+		eval = static_cast<short>(v & 0xffff);
+		return true;
+	}
+
+	void store( uint64_t key, short eval ) {
+		data_[key & mask_] = (key & ~uint64_t(0xffff)) | static_cast<unsigned short>(eval);
+	}
+
+private:
+	uint64_t* data_;
+	uint64_t mask_;
+};
+
+#endif
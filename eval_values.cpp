@@ -1,5 +1,6 @@
 #include "chess.hpp"
 #include "eval_values.hpp"
+#include "material_table.hpp"
 #include "tables.hpp"
 #include "util.hpp"
 
@@ -217,14 +218,17 @@ void init()
 	knight_outposts[1]              = score( 13, 26 );
 	bishop_outposts[0]              = score( 5, 13 );
 	bishop_outposts[1]              = score( 12, 12 );
-	trapped_rook[0].mg()            = -38;
-	trapped_rook[1].mg()            = -120;
+	trapped_rook[0].set_mg( -38 );
+	trapped_rook[1].set_mg( -120 );
 
 	update_derived();
 }
 
 void update_derived()
 {
+	// Cached entries are computed from the old values
+	material_table::clear();
+
 	initial_material =
 		material_values[pieces::knight] * 2 +
 		material_values[pieces::bishop] * 2 +
@@ -238,22 +242,22 @@ void update_derived()
 
 	auto update_mobility = []( int count, score* mobility, score& rise, score& min, score& duration ) {
 
-		auto update_mobility_phase = []( int count, score::phase_ref f, score* mobility, short rise, short min, short duration ) {
+		auto update_mobility_phase = []( int count, score::phase_getter get, score::phase_setter set, score* mobility, short rise, short min, short duration ) {
 
 			int mid = min + duration / 2;
-			(mobility[mid].*f)() = (duration % 2) ? (-rise / 2) : 0;
+			(mobility[mid].*set)( (duration % 2) ? (-rise / 2) : 0 );
 
 			for( int i = mid - 1; i >= 0; --i ) {
-				(mobility[i].*f)() = (mobility[i + 1].*f)() - ((i >= min) ? rise : 1);
+				(mobility[i].*set)( (mobility[i + 1].*get)() - ((i >= min) ? rise : 1) );
 			}
 
 			for( int i = mid + 1; i <= count; ++i ) {
-				(mobility[i].*f)() = (mobility[i - 1].*f)() + ((i <= (min + duration)) ? rise : 1);
+				(mobility[i].*set)( (mobility[i - 1].*get)() + ((i <= (min + duration)) ? rise : 1) );
 			}
 		};
 
-		update_mobility_phase( count, &score::mg, mobility, rise.mg(), min.mg(), duration.mg() );
-		update_mobility_phase( count, &score::eg, mobility, rise.eg(), min.eg(), duration.eg() );
+		update_mobility_phase( count, &score::mg, &score::set_mg, mobility, rise.mg(), min.mg(), duration.mg() );
+		update_mobility_phase( count, &score::eg, &score::set_eg, mobility, rise.eg(), min.eg(), duration.eg() );
 	};
 
 	for( int i = pieces::knight; i <= pieces::queen; ++i ) {
@@ -312,24 +316,34 @@ void update_derived()
 
 	for( int file = 0; file < 8; ++file ) {
 		for( int i = 0; i < 6; ++i ) {
-			advanced_passed_pawn[file][i].mg() = static_cast<short>(double(passed_pawn[file].mg()) * (1 + std::pow( double(i), double(passed_pawn_advance_power.mg()) / 100.0 ) ));
-			advanced_passed_pawn[file][i].eg() = static_cast<short>(double(passed_pawn[file].eg()) * (1 + std::pow( double(i), double(passed_pawn_advance_power.eg()) / 100.0 ) ));
+			advanced_passed_pawn[file][i].set_mg( static_cast<short>(double(passed_pawn[file].mg()) * (1 + std::pow( double(i), double(passed_pawn_advance_power.mg()) / 100.0 ) )) );
+			advanced_passed_pawn[file][i].set_eg( static_cast<short>(double(passed_pawn[file].eg()) * (1 + std::pow( double(i), double(passed_pawn_advance_power.eg()) / 100.0 ) )) );
 		}
 	}
 }
 
+bool set_min_phase( score& s, score::phase_getter get, score::phase_setter set, short rhs )
+{
+	short v = (s.*get)();
+	if( set_min( v, rhs ) ) {
+		(s.*set)( v );
+		return true;
+	}
+	return false;
+}
+
 bool sane_base( bool& changed )
 {
 	auto check_mobility = [&changed]( short count, score& min, score& duration ) {
 		
-		auto check_mobility_phase = [&changed]( int count, score::value_type& min, score::value_type& duration ) {
+		auto check_mobility_phase = [&changed]( int count, score::phase_getter get, score::phase_setter set, score& min, score& duration ) {
 
-			changed |= set_min( min, static_cast<short>(count - 1) );
-			changed |= set_min( duration, static_cast<short>(count - min) );
+			changed |= set_min_phase( min, get, set, static_cast<short>(count - 1) );
+			changed |= set_min_phase( duration, get, set, static_cast<short>(count - (min.*get)()) );
 		};
 
-		check_mobility_phase( count, min.mg(), duration.mg() );
-		check_mobility_phase( count, min.eg(), duration.eg() );
+		check_mobility_phase( count, &score::mg, &score::set_mg, min, duration );
+		check_mobility_phase( count, &score::eg, &score::set_eg, min, duration );
 	};
 
 	for( int i = pieces::knight; i <= pieces::queen; ++i ) {
@@ -359,27 +373,27 @@ bool normalize()
 	bool changed = false;
 
 	for( int i = 1; i < 4; ++i ) {
-		changed |= set_min( passed_pawn_base[i].mg(), static_cast<short>(passed_pawn_base[0].mg() / 3) );
-		changed |= set_min( passed_pawn_base[i].eg(), static_cast<short>(passed_pawn_base[0].eg() / 3) );
-		changed |= set_min( candidate_passed_pawn_base[i].mg(), static_cast<short>(candidate_passed_pawn_base[0].mg() / 3) );
-		changed |= set_min( candidate_passed_pawn_base[i].eg(), static_cast<short>(candidate_passed_pawn_base[0].eg() / 3) );
+		changed |= set_min_phase( passed_pawn_base[i], &score::mg, &score::set_mg, static_cast<short>(passed_pawn_base[0].mg() / 3) );
+		changed |= set_min_phase( passed_pawn_base[i], &score::eg, &score::set_eg, static_cast<short>(passed_pawn_base[0].eg() / 3) );
+		changed |= set_min_phase( candidate_passed_pawn_base[i], &score::mg, &score::set_mg, static_cast<short>(candidate_passed_pawn_base[0].mg() / 3) );
+		changed |= set_min_phase( candidate_passed_pawn_base[i], &score::eg, &score::set_eg, static_cast<short>(candidate_passed_pawn_base[0].eg() / 3) );
 		for( int c = 0; c < 2; ++c ) {
-			changed |= set_min( isolated_pawn_base[c][i].mg(), static_cast<short>(isolated_pawn_base[c][0].mg() / 3) );
-			changed |= set_min( isolated_pawn_base[c][i].eg(), static_cast<short>(isolated_pawn_base[c][0].eg() / 3) );
-			changed |= set_min( doubled_pawn_base[c][i].mg(), static_cast<short>(doubled_pawn_base[c][0].mg() / 3) );
-			changed |= set_min( doubled_pawn_base[c][i].eg(), static_cast<short>(doubled_pawn_base[c][0].eg() / 3) );
-			changed |= set_min( connected_pawn_base[c][i].mg(), static_cast<short>(connected_pawn_base[c][0].mg() / 3) );
-			changed |= set_min( connected_pawn_base[c][i].eg(), static_cast<short>(connected_pawn_base[c][0].eg() / 3) );
-			changed |= set_min( backward_pawn_base[c][i].mg(), static_cast<short>(backward_pawn_base[c][0].mg() / 3) );
-			changed |= set_min( backward_pawn_base[c][i].eg(), static_cast<short>(backward_pawn_base[c][0].eg() / 3) );
+			changed |= set_min_phase( isolated_pawn_base[c][i], &score::mg, &score::set_mg, static_cast<short>(isolated_pawn_base[c][0].mg() / 3) );
+			changed |= set_min_phase( isolated_pawn_base[c][i], &score::eg, &score::set_eg, static_cast<short>(isolated_pawn_base[c][0].eg() / 3) );
+			changed |= set_min_phase( doubled_pawn_base[c][i], &score::mg, &score::set_mg, static_cast<short>(doubled_pawn_base[c][0].mg() / 3) );
+			changed |= set_min_phase( doubled_pawn_base[c][i], &score::eg, &score::set_eg, static_cast<short>(doubled_pawn_base[c][0].eg() / 3) );
+			changed |= set_min_phase( connected_pawn_base[c][i], &score::mg, &score::set_mg, static_cast<short>(connected_pawn_base[c][0].mg() / 3) );
+			changed |= set_min_phase( connected_pawn_base[c][i], &score::eg, &score::set_eg, static_cast<short>(connected_pawn_base[c][0].eg() / 3) );
+			changed |= set_min_phase( backward_pawn_base[c][i], &score::mg, &score::set_mg, static_cast<short>(backward_pawn_base[c][0].mg() / 3) );
+			changed |= set_min_phase( backward_pawn_base[c][i], &score::eg, &score::set_eg, static_cast<short>(backward_pawn_base[c][0].eg() / 3) );
 		}
 	}
 
 	for( int i = 0; i < 3; ++i ) {
-		changed |= set_min( pawn_shield[i+1].mg(), pawn_shield[i].mg() );
-		changed |= set_min( pawn_shield[i+1].eg(), pawn_shield[i].eg() );
-		changed |= set_min( pawn_shield_attack[i+1].mg(), pawn_shield_attack[i].mg() );
-		changed |= set_min( pawn_shield_attack[i+1].eg(), pawn_shield_attack[i].eg() );
+		changed |= set_min_phase( pawn_shield[i+1], &score::mg, &score::set_mg, pawn_shield[i].mg() );
+		changed |= set_min_phase( pawn_shield[i+1], &score::eg, &score::set_eg, pawn_shield[i].eg() );
+		changed |= set_min_phase( pawn_shield_attack[i+1], &score::mg, &score::set_mg, pawn_shield_attack[i].mg() );
+		changed |= set_min_phase( pawn_shield_attack[i+1], &score::eg, &score::set_eg, pawn_shield_attack[i].eg() );
 	}
 
 	return changed;
@@ -1,7 +1,12 @@
 #include "hash.hpp"
 
+#include "util/thread.hpp"
+
 #include <string.h>
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <vector>
 
 struct entry {
 	uint64_t v;
@@ -11,57 +16,372 @@ struct entry {
 uint64_t const bucket_entries = 4;
 unsigned int const bucket_size = sizeof(entry) * bucket_entries;
 
+// See hash_format::dense for the layout
+namespace {
+uint64_t const dense_bucket_entries = 5;
+
+struct dense_bucket {
+	uint64_t v[dense_bucket_entries];
+	uint32_t key[dense_bucket_entries];
+	uint32_t unused;
+};
+
+static_assert( sizeof(dense_bucket) == bucket_size, "Dense bucket needs to be the same size as a regular one" );
+
+// The topmost bits. Dense tables are limited to 32 GiB so that the bucket
+// index stays below them.
+unsigned int const dense_key_shift = 35;
+unsigned int const dense_max_memory = 1u << (dense_key_shift - 20);
+uint32_t const dense_key_mask = 0x1fffffff;
+unsigned int const dense_full_eval_shift = 51;
+unsigned int const dense_full_eval_low_bits = 13;
+
+inline uint32_t fold( uint64_t v )
+{
+	return static_cast<uint32_t>(v ^ (v >> 32));
+}
+}
+
+// Control block in front of the entries of a shared table
+struct shared_hash_header {
+	char magic[8];
+	uint64_t format;
+	uint64_t size;
+
+	// Number of processes using the table
+	atomic_uint64_t attached;
+
+	// Incremented whenever any of the processes starts a search
+	atomic_uint64_t age;
+
+	// Set by the creating process once the fields above are valid
+	atomic_uint64_t ready;
+};
+
+namespace {
+char const shared_magic[8] = { 'O', 'C', 'T', 'O', 'S', 'H', 'M', 'T' };
+
+// In seconds
+int const shared_ready_timeout = 60;
+}
+
 hash::hash()
 	: size_()
 	, key_mask_()
 	, data_()
+	, page_type_()
 	, init_size_()
+	, numa_()
+	, threads_(1)
+	, format_(hash_format::standard)
+	, shared_()
+	, fresh_ages_(1)
 {
 }
 
 
 hash::~hash()
 {
-	aligned_free( data_ );
+	free_table();
+}
+
+
+namespace {
+// Largest power of two not exceeding the given size in megabytes, at least 4 MiB.
+hash_key table_size( unsigned int max_size )
+{
+	hash_key max = static_cast<hash_key>(max_size) * 1024 * 1024;
+
+	hash_key size = 4 * 1024 * 1024;
+	while( size * 2 <= max ) {
+		size *= 2;
+	}
+
+	return size;
+}
 }
 
 
 bool hash::init( unsigned int max_size, bool reset )
 {
+	// If only the size changes, entries of the old table get migrated to the
+	// new one.
+	entry* old_data = 0;
+	hash_key old_size = 0;
+	hash_key old_key_mask = 0;
+
 	if( init_size_ != max_size || reset ) {
-		aligned_free( data_ );
-		data_ = 0;
 		init_size_ = max_size;
+		if( reset || !max_size ) {
+			free_table();
+		}
+		else if( data_ && table_size( max_size ) != size_ && shared_ ) {
+			// Processes still attached keep the old size, which makes
+			// attaching fail unless this one was the only user.
+			free_table();
+		}
+		else if( data_ && table_size( max_size ) != size_ ) {
+			old_data = data_;
+			old_size = size_;
+			old_key_mask = key_mask_;
+			data_ = 0;
+		}
 	}
 
-	while( !data_ && max_size > 0 ) {
-		hash_key max = static_cast<hash_key>(max_size) * 1024 * 1024;
+	if( !data_ && max_size > 0 && !shared_name_.empty() ) {
+		attach_shared( table_size( max_size ) );
+	}
 
-		size_ = 4 * 1024 * 1024;
-		while( size_ * 2 <= max ) {
-			size_ *= 2;
-		}
+	bool const allocated = !data_;
+	while( !data_ && max_size > 0 ) {
+		size_ = table_size( max_size );
 
 		// Make sure size is a multiple of block size
 		ASSERT( !(size_ % bucket_size) );
 		key_mask_ = (size_ / bucket_size) - 1;
 		key_mask_ *= bucket_size;
 
-		aligned_free( data_ );
-		data_ = reinterpret_cast<entry*>(page_aligned_malloc( size_ ));
+		data_ = reinterpret_cast<entry*>(huge_page_malloc( size_, page_type_ ));
 
 		if( !data_ ) {
 			max_size /= 2;
 		}
+		else if( numa_ ) {
+			// Needs to happen before first touch. Spreading the table over
+			// all nodes balances the memory traffic of all threads.
+			interleave_memory( data_, size_ );
+		}
+	}
+
+	if( old_data ) {
+		if( data_ ) {
+			migrate( old_data, old_size );
+			aligned_free( old_data );
+		}
+		else {
+			// Keep using the old table
+			data_ = old_data;
+			size_ = old_size;
+			key_mask_ = old_key_mask;
+		}
+	}
+	else if( data_ && allocated ) {
+		// Fresh pages are zero already, but touching them now keeps
+		// the page faults out of the search.
+		clear_data();
 	}
 
 	return data_ != 0;
 }
 
 
+bool hash::init( config const& conf, bool reset )
+{
+	if( numa_ != conf.numa ) {
+		numa_ = conf.numa;
+		reset = true;
+	}
+	if( format_ != conf.tt_format ) {
+		format_ = conf.tt_format;
+		reset = true;
+	}
+	if( shared_name_ != conf.shared_hash ) {
+		free_table();
+		shared_name_ = conf.shared_hash;
+		reset = true;
+	}
+	threads_ = conf.thread_count;
+
+	unsigned int memory = conf.memory;
+	if( format_ == hash_format::dense && memory > dense_max_memory ) {
+		memory = dense_max_memory;
+	}
+
+	return init( memory, reset );
+}
+
+
+bool hash::attach_shared( hash_key size )
+{
+	// The control block gets a page of its own so that the entries stay
+	// page-aligned.
+	uint64_t const offset = get_page_size();
+
+	bool created = false;
+	unsigned char* p = reinterpret_cast<unsigned char*>(map_shared_memory( shared_name_.c_str(), offset + size, created ));
+	if( !p ) {
+		std::cerr << "Could not attach to shared transposition table " << shared_name_ << ", falling back to a private table" << std::endl;
+		return false;
+	}
+
+	shared_hash_header* h = reinterpret_cast<shared_hash_header*>(p);
+	if( created ) {
+		// A fresh segment is all zeroes, no need to clear it. That keeps the
+		// time until it is ready short, regardless of its size.
+		if( numa_ ) {
+			interleave_memory( p + offset, size );
+		}
+
+		memcpy( h->magic, shared_magic, sizeof(h->magic) );
+		h->format = format_;
+		h->size = size;
+		atomic_store( h->attached, 1 );
+		atomic_store( h->age, 0 );
+		atomic_store( h->ready, 1 );
+	}
+	else {
+		// The creator only needs to fill in the header. Waiting for a long
+		// time means it has most likely died in between.
+		for( int i = 0; i < shared_ready_timeout * 100 && !h->ready; ++i ) {
+			if( i == 100 ) {
+				std::cerr << "Waiting for shared transposition table " << shared_name_ << " to get ready" << std::endl;
+			}
+			millisleep( 10 );
+		}
+		if( !h->ready ) {
+			std::cerr << "Shared transposition table " << shared_name_ << " did not get ready within " << shared_ready_timeout << " seconds, falling back to a private table" << std::endl;
+			aligned_free( p );
+			return false;
+		}
+		if( memcmp( h->magic, shared_magic, sizeof(h->magic) ) || h->format != static_cast<uint64_t>(format_) || h->size != size ) {
+			std::cerr << "Shared transposition table " << shared_name_ << " does not match size and format of the table, falling back to a private table" << std::endl;
+			aligned_free( p );
+			return false;
+		}
+		add_fetch( h->attached, 1 );
+	}
+
+	shared_ = h;
+	data_ = reinterpret_cast<entry*>(p + offset);
+	size_ = size;
+	key_mask_ = (size_ / bucket_size - 1) * bucket_size;
+	page_type_ = page_type::regular;
+
+	return true;
+}
+
+
+void hash::free_table()
+{
+	if( shared_ ) {
+		if( !sub_fetch( shared_->attached, 1 ) ) {
+			// Last one out. A process still in the middle of attaching ends
+			// up with a table of its own.
+			remove_shared_memory( shared_name_.c_str() );
+		}
+		aligned_free( shared_ );
+		shared_ = 0;
+	}
+	else {
+		aligned_free( data_ );
+	}
+	data_ = 0;
+}
+
+
+unsigned char hash::new_search( unsigned char clock )
+{
+	if( !shared_ ) {
+		fresh_ages_ = 1;
+		return clock;
+	}
+
+	// The halfmove clocks of unrelated games say nothing about each other,
+	// use a common counter instead. Searches of the other processes are
+	// likely still running, so their most recent ages count as current.
+	fresh_ages_ = static_cast<int>(std::min( static_cast<uint64_t>(shared_->attached), static_cast<uint64_t>(127) ));
+	return static_cast<unsigned char>(add_fetch( shared_->age, 1 ));
+}
+
+
 void hash::clear_data()
 {
-	memset( data_, 0, size_ );
+	parallel_clear( data_, size_, threads_ );
+}
+
+
+namespace {
+struct snapshot_header {
+	char magic[8];
+	uint64_t version;
+	uint64_t format;
+	uint64_t size;
+
+	// Snapshots from before this field was added read as 0, the
+	// hand-crafted evaluation they were made with.
+	uint64_t evaluator;
+};
+
+char const snapshot_magic[8] = { 'O', 'C', 'T', 'O', 'H', 'A', 'S', 'H' };
+
+// Data starts at a multiple of all common page sizes, so reads of it stay
+// page-aligned.
+uint64_t const snapshot_data_offset = 64 * 1024;
+}
+
+
+bool hash::save( std::string const& file, int version, uint64_t evaluator ) const
+{
+	if( !data_ ) {
+		return false;
+	}
+
+	std::ofstream out( file.c_str(), std::ofstream::out|std::ofstream::binary|std::ofstream::trunc );
+
+	snapshot_header h;
+	memcpy( h.magic, snapshot_magic, sizeof(h.magic) );
+	h.version = version;
+	h.format = format_;
+	h.size = size_;
+	h.evaluator = evaluator;
+
+	std::vector<char> header( snapshot_data_offset, 0 );
+	memcpy( &header[0], &h, sizeof(h) );
+	out.write( &header[0], header.size() );
+
+	// Entries may change while writing, the lockless scheme sorts it out on
+	// lookup.
+	out.write( reinterpret_cast<char const*>(data_), size_ );
+	out.close();
+
+	if( !out ) {
+		std::cerr << "Could not write transposition table to " << file << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+bool hash::load( std::string const& file, int version, uint64_t evaluator )
+{
+	std::ifstream in( file.c_str(), std::ifstream::in|std::ifstream::binary );
+
+	snapshot_header h;
+	if( !in.read( reinterpret_cast<char*>(&h), sizeof(h) ) || memcmp( h.magic, snapshot_magic, sizeof(h.magic) ) ) {
+		std::cerr << "Not a transposition table file: " << file << std::endl;
+		return false;
+	}
+	if( h.version != static_cast<uint64_t>(version) ) {
+		std::cerr << "Transposition table file " << file << " is from a different evaluation version" << std::endl;
+		return false;
+	}
+	if( h.evaluator != evaluator ) {
+		std::cerr << "Transposition table file " << file << " was made with a different evaluator" << std::endl;
+		return false;
+	}
+	if( !data_ || h.size != size_ || h.format != static_cast<uint64_t>(format_) ) {
+		std::cerr << "Transposition table file " << file << " does not match size and format of the table" << std::endl;
+		return false;
+	}
+
+	if( !in.seekg( snapshot_data_offset ) || !in.read( reinterpret_cast<char*>(data_), size_ ) ) {
+		std::cerr << "Could not read transposition table from " << file << std::endl;
+		clear_data();
+		return false;
+	}
+
+	return true;
 }
 
 
@@ -85,6 +405,177 @@ enum type : uint64_t {
 };
 }
 
+
+namespace {
+// Priority of an entry when migrating: Entries from the most recent search
+// first, then by remaining depth.
+unsigned int migration_priority( uint64_t v, unsigned char newest_age )
+{
+	unsigned char age = (v >> field_shifts::age) & field_masks::age;
+	unsigned int depth = (v >> field_shifts::depth) & field_masks::depth;
+	return (age == newest_age ? field_masks::depth + 1 : 0) + depth;
+}
+
+// Ages wrap around, newest is the one the most others are behind of. Only
+// looks at a sample of the table, that's plenty.
+template<typename F>
+unsigned char newest_age( uint64_t bucket_count, F const& entry_v, uint64_t entries_per_bucket )
+{
+	uint64_t const sample = std::min( bucket_count, static_cast<uint64_t>(65536) );
+
+	bool found = false;
+	unsigned char newest = 0;
+	for( uint64_t b = 0; b < sample; ++b ) {
+		for( uint64_t i = 0; i < entries_per_bucket; ++i ) {
+			uint64_t v = entry_v( b, i );
+			if( !v ) {
+				continue;
+			}
+			unsigned char age = (v >> field_shifts::age) & field_masks::age;
+			if( !found || static_cast<signed char>(age - newest) > 0 ) {
+				newest = age;
+				found = true;
+			}
+		}
+	}
+
+	return newest;
+}
+}
+
+
+void hash::migrate( entry const* old_data, hash_key old_size )
+{
+	uint64_t const old_buckets = old_size / bucket_size;
+	uint64_t const new_buckets = size_ / bucket_size;
+
+	unsigned char const* old_bytes = reinterpret_cast<unsigned char const*>(old_data);
+	unsigned char* new_bytes = reinterpret_cast<unsigned char*>(data_);
+
+	// The bucket index of the smallest possible table is bits 6 to 21 of the
+	// key. In the standard format, bits above are stored in the entries, so
+	// the key can be reconstructed far enough to compute the bucket in the
+	// new table. Entries get copied unchanged, the lockless xor does not
+	// involve the bucket index.
+#if USE_STATISTICS >= 2
+	stats_.entries = 0;
+#endif
+
+	if( format_ == hash_format::dense ) {
+		unsigned char const newest = newest_age( old_buckets, [old_bytes]( uint64_t b, uint64_t i ) {
+			return reinterpret_cast<dense_bucket const*>(old_bytes + b * bucket_size)->v[i];
+		}, dense_bucket_entries );
+
+		// The dense format only stores the topmost bits of the key. When
+		// growing, the index bits between those of the old table and the
+		// stored ones are unknown, so the new bucket of an entry cannot be
+		// determined. The table starts out empty instead.
+		hash_key const known_bits = (old_size - 1) | ~((1ull << dense_key_shift) - 1);
+		if( key_mask_ & ~known_bits ) {
+			clear_data();
+			return;
+		}
+
+		parallel_for( new_buckets, threads_, [&]( uint64_t begin, uint64_t end ) {
+			for( uint64_t b = begin; b < end; ++b ) {
+				dense_bucket kept;
+				memset( &kept, 0, sizeof(kept) );
+				unsigned int prio[dense_bucket_entries] = {};
+
+				// When shrinking, several old buckets map to the same new one.
+				for( uint64_t ob = b % old_buckets; ob < old_buckets; ob += new_buckets ) {
+					dense_bucket const* old_bucket = reinterpret_cast<dense_bucket const*>(old_bytes + ob * bucket_size);
+					for( unsigned int i = 0; i < dense_bucket_entries; ++i ) {
+						uint64_t v = old_bucket->v[i];
+						if( !v ) {
+							continue;
+						}
+						uint32_t const partial = (old_bucket->key[i] ^ fold( v )) & dense_key_mask;
+
+						// Entries from different old buckets can share the
+						// stored bits, a lookup would only ever find one.
+						unsigned int lowest = 0;
+						for( unsigned int j = 0; j < dense_bucket_entries; ++j ) {
+							if( prio[j] && !((kept.key[j] ^ fold( kept.v[j] ) ^ partial) & dense_key_mask) ) {
+								lowest = j;
+								break;
+							}
+							if( prio[j] < prio[lowest] ) {
+								lowest = j;
+							}
+						}
+
+						unsigned int p = migration_priority( v, newest ) + 1;
+						if( p > prio[lowest] ) {
+							prio[lowest] = p;
+							kept.v[lowest] = v;
+							kept.key[lowest] = old_bucket->key[i];
+						}
+					}
+				}
+
+#if USE_STATISTICS >= 2
+				for( unsigned int i = 0; i < dense_bucket_entries; ++i ) {
+					if( kept.v[i] ) {
+						add_relaxed( stats_.entries, 1 );
+					}
+				}
+#endif
+				memcpy( new_bytes + b * bucket_size, &kept, bucket_size );
+			}
+		} );
+	}
+	else {
+		unsigned char const newest = newest_age( old_buckets, [old_bytes]( uint64_t b, uint64_t i ) {
+			return reinterpret_cast<entry const*>(old_bytes + b * bucket_size)[i].v;
+		}, bucket_entries );
+
+		parallel_for( new_buckets, threads_, [&]( uint64_t begin, uint64_t end ) {
+			for( uint64_t b = begin; b < end; ++b ) {
+				entry kept[bucket_entries];
+				memset( kept, 0, sizeof(kept) );
+				unsigned int prio[bucket_entries] = {};
+
+				// When shrinking, several old buckets map to the same new one.
+				for( uint64_t ob = b % old_buckets; ob < old_buckets; ob += new_buckets ) {
+					entry const* old_bucket = reinterpret_cast<entry const*>(old_bytes + ob * bucket_size);
+					for( unsigned int i = 0; i < bucket_entries; ++i ) {
+						uint64_t v = old_bucket[i].v;
+						if( !v ) {
+							continue;
+						}
+						hash_key key = ((old_bucket[i].key ^ v) & 0xffffffffffc00000ull) | (ob * bucket_size);
+						if( (key & key_mask_) != b * bucket_size ) {
+							continue;
+						}
+
+						unsigned int p = migration_priority( v, newest ) + 1;
+						unsigned int lowest = 0;
+						for( unsigned int j = 1; j < bucket_entries; ++j ) {
+							if( prio[j] < prio[lowest] ) {
+								lowest = j;
+							}
+						}
+						if( p > prio[lowest] ) {
+							prio[lowest] = p;
+							kept[lowest] = old_bucket[i];
+						}
+					}
+				}
+
+#if USE_STATISTICS >= 2
+				for( unsigned int i = 0; i < bucket_entries; ++i ) {
+					if( kept[i].v ) {
+						add_relaxed( stats_.entries, 1 );
+					}
+				}
+#endif
+				memcpy( new_bytes + b * bucket_size, kept, bucket_size );
+			}
+		} );
+	}
+}
+
 void hash::store( hash_key key, unsigned short remaining_depth, unsigned char ply, short eval, short alpha, short beta, move const& best_move, unsigned char clock, short full_eval )
 {
 	score_type::type t;
@@ -120,6 +611,11 @@ void hash::store( hash_key key, unsigned short remaining_depth, unsigned char pl
 	v |= static_cast<uint64_t>(t) << field_shifts::node_type;
 	v |= static_cast<uint64_t>(static_cast<unsigned short>(eval)) << field_shifts::score;
 
+	if( format_ == hash_format::dense ) {
+		store_dense( key, v, best_move, clock, full_eval );
+		return;
+	}
+
 	for( unsigned int i = 0; i < bucket_entries; ++i ) {
 		uint64_t old_v = (bucket + i)->v;
 		if( !(((old_v ^ (bucket + i)->key) ^ key) & 0xffffffffffc0003full ) ) {
@@ -148,7 +644,7 @@ void hash::store( hash_key key, unsigned short remaining_depth, unsigned char pl
 	for( unsigned int i = 0; i < bucket_entries; ++i ) {
 		unsigned char old_age = ((bucket + i)->v >> field_shifts::age) & field_masks::age;
 		unsigned short old_depth = ((bucket + i)->v >> field_shifts::depth) & field_masks::depth;
-		if( old_age != clock && old_depth < lowest_depth ) {
+		if( stale( old_age, clock ) && old_depth < lowest_depth ) {
 			lowest_depth = old_depth;
 			pos = bucket + i;
 		}
@@ -178,59 +674,154 @@ void hash::store( hash_key key, unsigned short remaining_depth, unsigned char pl
 }
 
 
-score_type::type hash::lookup( hash_key key, unsigned short remaining_depth, unsigned char ply, short alpha, short beta, short& eval, move& best_move, short& full_eval )
+void hash::store_dense( hash_key key, uint64_t v, move const& best_move, unsigned char clock, short full_eval )
 {
 	uint64_t bucket_offset = key & key_mask_;
-	entry const* bucket = reinterpret_cast<entry const*>(reinterpret_cast<unsigned char const*>(data_) + bucket_offset);
-
-	for( unsigned int i = 0; i < bucket_entries; ++i, ++bucket ) {
-		uint64_t v = bucket->v;
-		uint64_t stored_key = bucket->key;
-		if( ((v ^ stored_key) ^ key) & 0xffffffffffc0003full ) {
-			continue;
-		}
-		full_eval = static_cast<short>(static_cast<unsigned short>((stored_key >> 6) & 0xFFFFull));
+	dense_bucket* bucket = reinterpret_cast<dense_bucket*>(reinterpret_cast<unsigned char*>(data_) + bucket_offset);
 
-		best_move.d = (v >> field_shifts::move) & field_masks::move;
+	uint32_t const partial_key = static_cast<uint32_t>(key >> dense_key_shift) & dense_key_mask;
 
-		unsigned short depth = (v >> field_shifts::depth) & field_masks::depth;
+	unsigned short const fe = static_cast<unsigned short>(full_eval);
+	v |= static_cast<uint64_t>(fe) << dense_full_eval_shift;
+	uint32_t const key_word = partial_key | (static_cast<uint32_t>(fe >> dense_full_eval_low_bits) << 29);
 
-		if( depth >= remaining_depth ) {
-			unsigned char type = (v >> field_shifts::node_type) & field_masks::node_type;
-			eval = (v >> field_shifts::score) & field_masks::score;
+	for( unsigned int i = 0; i < dense_bucket_entries; ++i ) {
+		uint64_t old_v = bucket->v[i];
+		if( old_v && !((bucket->key[i] ^ fold( old_v ) ^ partial_key) & dense_key_mask) ) {
 
-			if( eval > result::win_threshold ) {
-				eval -= ply;
+			// If overwriting existing entry, copy existing move if we have none.
+			// Otherwise we might end up with truncated pv.
+			if( best_move.empty() ) {
+				v |= old_v & (field_masks::move << field_shifts::move);
 			}
-			else if( eval < result::loss_threshold ) {
-				eval += ply;
+			else {
+				v |= static_cast<uint64_t>(best_move.d) << field_shifts::move;
 			}
 
-			if( ( type == score_type::exact ) ||
-				( type == score_type::lower_bound && beta <= eval ) ||
-				( type == score_type::upper_bound && alpha >= eval ) )
-			{
+			bucket->v[i] = v;
+			bucket->key[i] = key_word ^ fold( v );
+			return;
+		}
+	}
+
+	v |= static_cast<uint64_t>(best_move.d) << field_shifts::move;
+
+	// Same replacement scheme as for the regular format, see above.
+	unsigned short lowest_depth = 511;
+	int pos = -1;
+	for( unsigned int i = 0; i < dense_bucket_entries; ++i ) {
+		unsigned char old_age = (bucket->v[i] >> field_shifts::age) & field_masks::age;
+		unsigned short old_depth = (bucket->v[i] >> field_shifts::depth) & field_masks::depth;
+		if( stale( old_age, clock ) && old_depth < lowest_depth ) {
+			lowest_depth = old_depth;
+			pos = i;
+		}
+	}
+
+	if( pos == -1 ) {
+		lowest_depth = 511;
+		for( unsigned int i = 0; i < dense_bucket_entries; ++i ) {
+			unsigned short old_depth = (bucket->v[i] >> field_shifts::depth) & field_masks::depth;
+			if( old_depth < lowest_depth ) {
+				lowest_depth = old_depth;
+				pos = i;
+			}
+		}
+	}
+
 #if USE_STATISTICS >= 2
-				add_relaxed( stats_.hits, 1 );
+	if( !bucket->v[pos] ) {
+		add_relaxed( stats_.entries, 1 );
+	}
+	else {
+		add_relaxed( stats_.index_collisions, 1 );
+	}
 #endif
-				return static_cast<score_type::type>(type);
+	bucket->v[pos] = v;
+	bucket->key[pos] = key_word ^ fold( v );
+}
+
+
+score_type::type hash::lookup( hash_key key, unsigned short remaining_depth, unsigned char ply, short alpha, short beta, short& eval, move& best_move, short& full_eval )
+{
+	uint64_t bucket_offset = key & key_mask_;
+
+	if( format_ == hash_format::dense ) {
+		dense_bucket const* bucket = reinterpret_cast<dense_bucket const*>(reinterpret_cast<unsigned char const*>(data_) + bucket_offset);
+
+		uint32_t const partial_key = static_cast<uint32_t>(key >> dense_key_shift) & dense_key_mask;
+		for( unsigned int i = 0; i < dense_bucket_entries; ++i ) {
+			uint64_t v = bucket->v[i];
+			uint32_t key_word = bucket->key[i] ^ fold( v );
+			if( !v || (key_word & dense_key_mask) != partial_key ) {
+				continue;
 			}
+
+			unsigned short fe = static_cast<unsigned short>(v >> dense_full_eval_shift);
+			fe |= static_cast<unsigned short>((key_word >> 29) << dense_full_eval_low_bits);
+			full_eval = static_cast<short>(fe);
+
+			return evaluate_entry( v, remaining_depth, ply, alpha, beta, eval, best_move );
 		}
+	}
+	else {
+		entry const* bucket = reinterpret_cast<entry const*>(reinterpret_cast<unsigned char const*>(data_) + bucket_offset);
+
+		for( unsigned int i = 0; i < bucket_entries; ++i, ++bucket ) {
+			uint64_t v = bucket->v;
+			uint64_t stored_key = bucket->key;
+			if( ((v ^ stored_key) ^ key) & 0xffffffffffc0003full ) {
+				continue;
+			}
+			full_eval = static_cast<short>(static_cast<unsigned short>((stored_key >> 6) & 0xFFFFull));
+
+			return evaluate_entry( v, remaining_depth, ply, alpha, beta, eval, best_move );
+		}
+	}
 
 #if USE_STATISTICS >= 2
-		if( !best_move.empty() ) {
-			add_relaxed( stats_.best_move, 1 );
+	add_relaxed( stats_.misses, 1 );
+#endif
+
+	return score_type::none;
+}
+
+
+score_type::type hash::evaluate_entry( uint64_t v, unsigned short remaining_depth, unsigned char ply, short alpha, short beta, short& eval, move& best_move )
+{
+	best_move.d = (v >> field_shifts::move) & field_masks::move;
+
+	unsigned short depth = (v >> field_shifts::depth) & field_masks::depth;
+
+	if( depth >= remaining_depth ) {
+		unsigned char type = (v >> field_shifts::node_type) & field_masks::node_type;
+		eval = (v >> field_shifts::score) & field_masks::score;
+
+		if( eval > result::win_threshold ) {
+			eval -= ply;
 		}
-		else {
-			add_relaxed( stats_.misses, 1 );
+		else if( eval < result::loss_threshold ) {
+			eval += ply;
 		}
-#endif
 
-		return score_type::none;
+		if( ( type == score_type::exact ) ||
+			( type == score_type::lower_bound && beta <= eval ) ||
+			( type == score_type::upper_bound && alpha >= eval ) )
+		{
+#if USE_STATISTICS >= 2
+			add_relaxed( stats_.hits, 1 );
+#endif
+			return static_cast<score_type::type>(type);
+		}
 	}
 
 #if USE_STATISTICS >= 2
-	add_relaxed( stats_.misses, 1 );
+	if( !best_move.empty() ) {
+		add_relaxed( stats_.best_move, 1 );
+	}
+	else {
+		add_relaxed( stats_.misses, 1 );
+	}
 #endif
 
 	return score_type::none;
@@ -239,7 +830,7 @@ score_type::type hash::lookup( hash_key key, unsigned short remaining_depth, uns
 
 uint64_t hash::max_hash_entry_count() const
 {
-	return size_ / bucket_size * bucket_entries;
+	return size_ / bucket_size * (format_ == hash_format::dense ? dense_bucket_entries : bucket_entries);
 }
 
 
@@ -259,6 +850,7 @@ hash::stats hash::get_stats(bool reset)
 		stats_.misses = 0;
 		stats_.index_collisions = 0;
 		stats_.best_move = 0;
+		stats_.type1_collisions = 0;
 	}
 	return ret;
 }
@@ -270,6 +862,7 @@ hash::stats::stats()
 	, best_move()
 	, misses()
 	, index_collisions()
+	, type1_collisions()
 {
 	ASSERT( entries.is_lock_free() );
 }
@@ -282,6 +875,7 @@ hash::stats::stats( stats const& s )
 	atomic_store( best_move, s.best_move );
 	atomic_store( misses, s.misses );
 	atomic_store( index_collisions, s.index_collisions );
+	atomic_store( type1_collisions, s.type1_collisions );
 }
 
 
@@ -293,6 +887,7 @@ hash::stats& hash::stats::operator=( stats const& s )
 		atomic_store( best_move, s.best_move);
 		atomic_store( misses, s.misses);
 		atomic_store( index_collisions, s.index_collisions );
+		atomic_store( type1_collisions, s.type1_collisions );
 	}
 
 	return *this;
@@ -7,6 +7,8 @@
 
 #include "util/atomic.hpp"
 
+#include <string>
+
 /*
  * General considerations:
  * 1) No expensive memory allocation stuff
@@ -62,7 +64,9 @@
  * into the bucket. We could do so, by e.g. only storing the partial zobrist
  * hash, given a large enough cache. Unfortunately, during earlier experinents
  * with the naive hashing, the extra arithmetic was shown to negatively impact
- * performance, so we stick with the 4 entries per bucket for now.
+ * performance, so we stick with the 4 entries per bucket by default.
+ * See hash_format::dense in config.hpp for a layout with 5 entries per bucket
+ * using partial keys. It is selectable at runtime to compare the two.
  * Another nice benefit with the 4 entries:
  * 64 bytes / 4 = 16 bytes, or two uint64_t which makes handling the data
  * extremely easy.
@@ -100,6 +104,7 @@ typedef uint64_t hash_key;
 
 class move;
 struct entry;
+struct shared_hash_header;
 
 namespace score_type {
 enum type {
@@ -129,14 +134,23 @@ public:
 		atomic_uint64_t best_move;
 		atomic_uint64_t misses;
 		atomic_uint64_t index_collisions;
+
+		// Hash moves found to be illegal in the position they got looked up for
+		atomic_uint64_t type1_collisions;
 	};
 
 	stats get_stats( bool reset );
+
+	void add_type1_collision() { add_relaxed( stats_.type1_collisions, 1 ); }
 #endif
 
 	// max_size is in megabytes
 	bool init( unsigned int max_size, bool reinit = false );
 
+	// Takes size, memory placement, format, the shared memory segment to use
+	// and the number of threads used for clearing from the configuration.
+	bool init( config const& conf, bool reinit = false );
+
 	// Returns type of match
 	// Even if score_type is none, lookup may set eval, best_move and full_eval.
 	// It however does not clear these values if nothing is found, the caller is
@@ -145,14 +159,66 @@ public:
 
 	void store( hash_key key, unsigned short depth, unsigned char ply, short eval, short alpha, short beta, move const& best_move, unsigned char clock, short full_eval );
 
+	// Starts loading the bucket of the key into the cache. Call as early as
+	// possible before lookup to hide memory latency.
+	void prefetch( hash_key key ) const {
+		::prefetch( reinterpret_cast<unsigned char const*>(data_) + (key & key_mask_) );
+	}
+
 	void free_hash();
 
+	// To be called when starting a search, returns the age to store its
+	// entries with. With a shared table, the age is taken from a counter
+	// common to all processes instead of the given halfmove clock.
+	unsigned char new_search( unsigned char clock );
+
+	bool shared() const { return shared_ != 0; }
+
+	// Writes the table to a file, tagged with the given evaluation version
+	// and the evaluator the full evaluations stored in it come from, see
+	// nnue::evaluator_id().
+	bool save( std::string const& file, int version, uint64_t evaluator ) const;
+
+	// Replaces the contents of the table with a file written by save. The
+	// file needs to match version and evaluator as well as size and format
+	// of the table. The file is read into the existing allocation, which
+	// keeps its NUMA placement and huge pages.
+	bool load( std::string const& file, int version, uint64_t evaluator );
+
 	void clear_data();
 
 	uint64_t max_hash_entry_count() const;
 
 	static unsigned short max_depth();
+
+	// If set, only part of the key is verified on lookup and type-1
+	// collisions are to be expected.
+	bool partial_keys() const { return format_ == hash_format::dense; }
+
+	page_type::type get_page_type() const { return page_type_; }
 private:
+	// Maps the shared memory segment, creating it if needed
+	bool attach_shared( hash_key size );
+
+	// Frees or detaches from the table
+	void free_table();
+
+	// Entries from other searches get replaced first. With a shared table,
+	// the most recent searches of the other processes count as current too.
+	bool stale( unsigned char age, unsigned char clock ) const {
+		int d = static_cast<signed char>(clock - age);
+		return d >= fresh_ages_ || d <= -fresh_ages_;
+	}
+
+	void store_dense( hash_key key, uint64_t v, move const& best_move, unsigned char clock, short full_eval );
+
+	// Moves the entries of the old table into the freshly allocated one,
+	// keeping the most valuable ones if the table shrinks.
+	void migrate( entry const* old_data, hash_key old_size );
+
+	// Decodes a found entry
+	score_type::type evaluate_entry( uint64_t v, unsigned short remaining_depth, unsigned char ply, short alpha, short beta, short& eval, move& best_move );
+
 #if USE_STATISTICS >= 2
 	stats stats_;
 #endif
@@ -160,8 +226,23 @@ private:
 	hash_key size_;
 	hash_key key_mask_;
 	entry* data_;
+	page_type::type page_type_;
 
 	unsigned int init_size_;
+
+	// If set, pages get interleaved across all NUMA nodes
+	bool numa_;
+
+	// Number of threads clearing the table
+	unsigned int threads_;
+
+	hash_format::type format_;
+
+	std::string shared_name_;
+	shared_hash_header* shared_;
+
+	// See stale()
+	int fresh_ages_;
 };
 
 #endif //__HASH_H__
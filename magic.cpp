@@ -2,13 +2,76 @@
 #include "magic.hpp"
 #include "magic_values.hpp"
 #include "sliding_piece_attacks.hpp"
+#include "util/platform.hpp"
+
+#include <vector>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <immintrin.h>
+#define HAS_PEXT 1
+#elif defined(__GNUC__) && defined(__x86_64__)
+#define HAS_PEXT 1
+#else
+#define HAS_PEXT 0
+#endif
+
+// Two-level attack tables, selected with make COMPACT_SLIDER_TABLES=1: the
+// magic key or PEXT index selects a byte, the byte one of the distinct
+// attack sets of the square. 105 KiB of bytes per lookup type and 49 KiB of
+// attack sets instead of 841 KiB of attack sets per lookup type, at the cost
+// of one more dependent load per lookup. Only worth it if the L2 cache is
+// too small to hold the plain tables next to the transposition table.
+#ifndef COMPACT_SLIDER_TABLES
+#define COMPACT_SLIDER_TABLES 0
+#endif
+
+#if COMPACT_SLIDER_TABLES
+typedef unsigned char table_entry;
+static table_entry const unused_entry = 0xff;
+#else
+typedef uint64_t table_entry;
+static table_entry const unused_entry = 0;
+#endif
 
 static uint64_t rook_magic_offsets[64] = {0};
-static uint64_t *rook_magic_values = 0;
+static table_entry *rook_magic_values = 0;
 static uint64_t bishop_magic_offsets[64] = {0};
-static uint64_t *bishop_magic_values = 0;
+static table_entry *bishop_magic_values = 0;
+
+static uint64_t rook_pext_offsets[64] = {0};
+static table_entry *rook_pext_values = 0;
+static uint64_t bishop_pext_offsets[64] = {0};
+static table_entry *bishop_pext_values = 0;
+
+// Both lookup types of a square select from the same attack sets, unused
+// with the plain tables.
+static uint64_t rook_attack_offsets[64] = {0};
+static uint64_t bishop_attack_offsets[64] = {0};
+#if COMPACT_SLIDER_TABLES
+static std::vector<uint64_t> distinct_attacks;
+#endif
+
+static bool use_pext = false;
 
 namespace {
+#if HAS_PEXT
+#if defined(_MSC_VER)
+inline uint64_t pext( uint64_t value, uint64_t mask )
+{
+	return _pext_u64( value, mask );
+}
+#else
+// Inline assembly instead of the intrinsic, it does not require the callers
+// to be compiled for BMI2.
+inline uint64_t pext( uint64_t value, uint64_t mask )
+{
+	uint64_t ret;
+	__asm__( "pextq %2, %1, %0" : "=r" (ret) : "r" (value), "rm" (mask) );
+	return ret;
+}
+#endif
+#endif
+
 // Given mask with n bits set, expands lowest n bits of value to correspond to bits of mask.
 // v = 000000abc
 // m = 001010010
@@ -28,7 +91,39 @@ uint64_t expand( uint64_t value, uint64_t mask )
 	return ret;
 }
 
-uint64_t* init_magic( uint64_t* offsets, uint64_t const* shifts, uint64_t const* masks, uint64_t const* multipliers, uint64_t (*attacks)(uint64_t, uint64_t, uint64_t const (&)[8][64]), uint64_t const (&rays)[8][64] ) {
+#if COMPACT_SLIDER_TABLES
+// Index of the attack set among those of the square, adding it if new.
+table_entry make_entry( uint64_t attack_offset, uint64_t attack )
+{
+	uint64_t index = attack_offset;
+	while( index < distinct_attacks.size() && distinct_attacks[index] != attack ) {
+		++index;
+	}
+	if( index == distinct_attacks.size() ) {
+		distinct_attacks.push_back( attack );
+	}
+
+	ASSERT( index - attack_offset < unused_entry );
+	return static_cast<table_entry>(index - attack_offset);
+}
+
+inline uint64_t attack_set( uint64_t attack_offset, table_entry entry )
+{
+	return distinct_attacks[attack_offset + entry];
+}
+#else
+inline table_entry make_entry( uint64_t, uint64_t attack )
+{
+	return attack;
+}
+
+inline uint64_t attack_set( uint64_t, table_entry entry )
+{
+	return entry;
+}
+#endif
+
+table_entry* init_magic( uint64_t* offsets, uint64_t* attack_offsets, uint64_t const* shifts, uint64_t const* masks, uint64_t const* multipliers, uint64_t (*attacks)(uint64_t, uint64_t, uint64_t const (&)[8][64]), uint64_t const (&rays)[8][64] ) {
 	uint64_t offset = 0;
 	
 	for( unsigned int pi = 0; pi < 64; ++pi ) {
@@ -36,21 +131,24 @@ uint64_t* init_magic( uint64_t* offsets, uint64_t const* shifts, uint64_t const*
 		offset += 1ull << (64 - shifts[pi]);
 	}
 
-	uint64_t * values = new uint64_t[offset];
-	memset( values, 0, sizeof(uint64_t) * offset );
+	table_entry * values = new table_entry[offset];
+	memset( values, unused_entry, sizeof(table_entry) * offset );
 
 	offset = 0;
 	for( unsigned int pi = 0; pi < 64; ++pi ) {
-			
+#if COMPACT_SLIDER_TABLES
+		attack_offsets[pi] = distinct_attacks.size();
+#endif
+
 		for( unsigned int i = 0; i < (1ull << (64 - shifts[pi])); ++i ) {
 			uint64_t occ = expand( i, masks[pi] );
 
 			uint64_t key = occ * multipliers[pi];
 			key >>= shifts[pi];
 
-			uint64_t const attack = attacks( pi, occ, rays );
-			ASSERT( !values[offset + key] || values[offset + key] == attack );
-			values[offset + key] = attack;
+			table_entry const entry = make_entry( attack_offsets[pi], attacks( pi, occ, rays ) );
+			ASSERT( values[offset + key] == unused_entry || values[offset + key] == entry );
+			values[offset + key] = entry;
 		}
 			
 		offset += 1ull << (64 - shifts[pi]);
@@ -58,6 +156,27 @@ uint64_t* init_magic( uint64_t* offsets, uint64_t const* shifts, uint64_t const*
 
 	return values;
 }
+
+// The PEXT index of an occupancy is the same value expand got called with.
+table_entry* init_pext( uint64_t* offsets, uint64_t const* attack_offsets, uint64_t const* masks, uint64_t (*attacks)(uint64_t, uint64_t, uint64_t const (&)[8][64]), uint64_t const (&rays)[8][64] ) {
+	uint64_t offset = 0;
+
+	for( unsigned int pi = 0; pi < 64; ++pi ) {
+		offsets[pi] = offset;
+		offset += 1ull << popcount( masks[pi] );
+	}
+
+	table_entry * values = new table_entry[offset];
+
+	for( unsigned int pi = 0; pi < 64; ++pi ) {
+		uint64_t const count = 1ull << popcount( masks[pi] );
+		for( uint64_t i = 0; i < count; ++i ) {
+			values[offsets[pi] + i] = make_entry( attack_offsets[pi], attacks( pi, expand( i, masks[pi] ), rays ) );
+		}
+	}
+
+	return values;
+}
 }
 
 void init_magic()
@@ -65,28 +184,84 @@ void init_magic()
 	uint64_t rays[8][64];
 	init_rays( rays );
 
-	rook_magic_values = init_magic( rook_magic_offsets, rook_magic_shift, rook_magic_mask, rook_magic_multiplier, rook_attacks, rays );
-	bishop_magic_values = init_magic( bishop_magic_offsets, bishop_magic_shift, bishop_magic_mask, bishop_magic_multiplier, bishop_attacks, rays );
+	rook_magic_values = init_magic( rook_magic_offsets, rook_attack_offsets, rook_magic_shift, rook_magic_mask, rook_magic_multiplier, rook_attacks, rays );
+	bishop_magic_values = init_magic( bishop_magic_offsets, bishop_attack_offsets, bishop_magic_shift, bishop_magic_mask, bishop_magic_multiplier, bishop_attacks, rays );
+
+	if( slider_lookup_supported( slider_lookup::pext ) ) {
+		rook_pext_values = init_pext( rook_pext_offsets, rook_attack_offsets, rook_magic_mask, rook_attacks, rays );
+		bishop_pext_values = init_pext( bishop_pext_offsets, bishop_attack_offsets, bishop_magic_mask, bishop_attacks, rays );
+	}
+
+	use_pext = cpu_has_fast_pext() && slider_lookup_supported( slider_lookup::pext );
+}
+
+bool slider_lookup_supported( slider_lookup::type t )
+{
+	if( t == slider_lookup::pext ) {
+		return HAS_PEXT && cpu_has_bmi2();
+	}
+	return true;
+}
+
+slider_lookup::type get_slider_lookup()
+{
+	return use_pext ? slider_lookup::pext : slider_lookup::magic;
+}
+
+bool set_slider_lookup( slider_lookup::type t )
+{
+	if( !slider_lookup_supported( t ) ) {
+		return false;
+	}
+	if( t == slider_lookup::pext && !rook_pext_values ) {
+		return false;
+	}
+
+	use_pext = t == slider_lookup::pext;
+	return true;
+}
+
+char const* slider_lookup_name( slider_lookup::type t )
+{
+	switch( t ) {
+	case slider_lookup::pext:
+		return "pext";
+	case slider_lookup::magic:
+	default:
+		return "magic";
+	}
 }
 
 uint64_t rook_magic( uint64_t pi, uint64_t occ )
 {
+#if HAS_PEXT
+	if( use_pext ) {
+		return attack_set( rook_attack_offsets[pi], rook_pext_values[ rook_pext_offsets[pi] + pext( occ, rook_magic_mask[pi] ) ] );
+	}
+#endif
+
 	uint64_t relevant_occ = occ & rook_magic_mask[pi];
 	uint64_t key = relevant_occ * rook_magic_multiplier[pi];
 	key >>= rook_magic_shift[pi];
 
 	uint64_t offset = rook_magic_offsets[pi];
 
-	return rook_magic_values[ offset + key ];
+	return attack_set( rook_attack_offsets[pi], rook_magic_values[ offset + key ] );
 }
 
 uint64_t bishop_magic( uint64_t pi, uint64_t occ )
 {
+#if HAS_PEXT
+	if( use_pext ) {
+		return attack_set( bishop_attack_offsets[pi], bishop_pext_values[ bishop_pext_offsets[pi] + pext( occ, bishop_magic_mask[pi] ) ] );
+	}
+#endif
+
 	uint64_t relevant_occ = occ & bishop_magic_mask[pi];
 	uint64_t key = relevant_occ * bishop_magic_multiplier[pi];
 	key >>= bishop_magic_shift[pi];
 
 	uint64_t offset = bishop_magic_offsets[pi];
 
-	return bishop_magic_values[ offset + key ];
+	return attack_set( bishop_attack_offsets[pi], bishop_magic_values[ offset + key ] );
 }
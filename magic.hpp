@@ -3,9 +3,28 @@
 
 #include "chess.hpp"
 
+// Ways to look up the attacks of sliding pieces. Both use the same masks of
+// relevant blockers, they only differ in how those get turned into a table
+// index.
+namespace slider_lookup {
+enum type {
+	// Multiply-shift magics from magic_values.hpp
+	magic,
+
+	// BMI2 parallel bit extract, needs no multiplier and shift per square.
+	pext
+};
+}
+
+// Builds the tables and selects PEXT if the CPU has a fast implementation.
 void init_magic();
 
+bool slider_lookup_supported( slider_lookup::type t );
+slider_lookup::type get_slider_lookup();
+bool set_slider_lookup( slider_lookup::type t );
+char const* slider_lookup_name( slider_lookup::type t );
+
 uint64_t rook_magic( uint64_t pi, uint64_t occ );
 uint64_t bishop_magic( uint64_t pi, uint64_t occ );
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,163 @@
+#include "material_table.hpp"
+#include "eval_values.hpp"
+
+#include <string.h>
+
+material_entry::material_entry()
+	: endgame()
+	, opposite_bishops()
+{
+	scale[0] = 2;
+	scale[1] = 2;
+}
+
+
+namespace {
+struct material_table_entry {
+	uint64_t key;
+	uint64_t data;
+	endgame_function endgame;
+};
+
+unsigned int const table_bits = 13;
+material_table_entry table[1 << table_bits];
+
+namespace data_shifts {
+enum type : uint64_t {
+	imbalance_mg = 0,
+	imbalance_eg = 16,
+	scale_white = 32,
+	scale_black = 34,
+	opposite_bishops = 36,
+	valid = 63
+};
+}
+
+inline uint64_t key_word( uint64_t piece_sum, uint64_t data, endgame_function endgame )
+{
+	return piece_sum ^ data ^ reinterpret_cast<uint64_t>(endgame);
+}
+
+inline short count( uint64_t piece_sum, color::type c, pieces::type piece )
+{
+	return static_cast<short>((piece_sum >> ((piece - 1 + (c ? 5 : 0)) * 6)) & 0x3f);
+}
+
+score compute_imbalance( uint64_t piece_sum )
+{
+	short pawn_diff = count( piece_sum, color::white, pieces::pawn ) - count( piece_sum, color::black, pieces::pawn );
+
+	short minors[2];
+	minors[0] = count( piece_sum, color::white, pieces::knight ) + count( piece_sum, color::white, pieces::bishop );
+	minors[1] = count( piece_sum, color::black, pieces::knight ) + count( piece_sum, color::black, pieces::bishop );
+	short minor_diff = minors[0] - minors[1];
+
+	// TODO: Somehow handle queens
+	short major_diff = count( piece_sum, color::white, pieces::rook ) - count( piece_sum, color::black, pieces::rook );
+
+	score v;
+	while( minor_diff > 1 && major_diff < 0 ) {
+		v += eval_values::material_imbalance[1];
+		minor_diff -= 2;
+		++major_diff;
+	}
+	while( minor_diff < -1 && major_diff > 0 ) {
+		v -= eval_values::material_imbalance[1];
+		minor_diff += 2;
+		--major_diff;
+	}
+	while( pawn_diff > 2 && minor_diff < 0 ) {
+		pawn_diff -= 3;
+		++minor_diff;
+	}
+	while( pawn_diff < -2 && minor_diff > 0 ) {
+		pawn_diff += 3;
+		--minor_diff;
+	}
+	v += eval_values::material_imbalance[0] * minor_diff;
+
+	return v;
+}
+}
+
+
+namespace material_table {
+
+material_entry compute( uint64_t piece_sum )
+{
+	material_entry ret;
+
+	ret.imbalance = compute_imbalance( piece_sum );
+	ret.endgame = get_endgame_function( piece_sum );
+
+	// Same as position::material
+	short material[2];
+	for( int c = 0; c < 2; ++c ) {
+		material[c] = 0;
+		for( int piece = pieces::knight; piece <= pieces::queen; ++piece ) {
+			material[c] += eval_values::material_values[piece].mg() * count( piece_sum, static_cast<color::type>(c), static_cast<pieces::type>(piece) );
+		}
+	}
+
+	short const bishop = eval_values::material_values[pieces::bishop].mg();
+
+	// Check for endgames with opposite colored bishops, those are rather drawish :(
+	ret.opposite_bishops = material[0] == bishop && material[1] == bishop;
+
+	// If we're pawnless, an advantage of a single bishop or less is usually not enough to force a win.
+	//
+	// "You can tune Pawn values until doomsday, but you will never get anything that is remotely as good
+	//  as just dividing the score by (a completely guessed) two if the leading side has no Pawns." (H.G. Muller)
+	for( int c = 0; c < 2; ++c ) {
+		if( !count( piece_sum, static_cast<color::type>(c), pieces::pawn ) ) {
+			// Check material difference, assume that weaker side would just exchange material
+			if( (material[c] - material[1 - c]) <= bishop ) {
+				// If we don't even have enough material to force a win if opponent has nothing, it's a draw at best.
+				ret.scale[c] = (material[c] <= bishop) ? 0 : 1;
+			}
+		}
+	}
+
+	return ret;
+}
+
+
+material_entry probe( uint64_t piece_sum )
+{
+	material_table_entry& e = table[(piece_sum * 0x9e3779b97f4a7c15ull) >> (64 - table_bits)];
+
+	uint64_t data = e.data;
+	endgame_function endgame = e.endgame;
+	if( (data >> data_shifts::valid) && key_word( piece_sum, data, endgame ) == e.key ) {
+		material_entry ret;
+		ret.imbalance = score( static_cast<short>(data >> data_shifts::imbalance_mg), static_cast<short>(data >> data_shifts::imbalance_eg) );
+		ret.endgame = endgame;
+		ret.scale[color::white] = (data >> data_shifts::scale_white) & 0x3;
+		ret.scale[color::black] = (data >> data_shifts::scale_black) & 0x3;
+		ret.opposite_bishops = ((data >> data_shifts::opposite_bishops) & 0x1) != 0;
+		return ret;
+	}
+
+	material_entry ret = compute( piece_sum );
+
+	data = static_cast<uint64_t>(static_cast<unsigned short>(ret.imbalance.mg())) << data_shifts::imbalance_mg;
+	data |= static_cast<uint64_t>(static_cast<unsigned short>(ret.imbalance.eg())) << data_shifts::imbalance_eg;
+	data |= static_cast<uint64_t>(ret.scale[color::white]) << data_shifts::scale_white;
+	data |= static_cast<uint64_t>(ret.scale[color::black]) << data_shifts::scale_black;
+	data |= static_cast<uint64_t>(ret.opposite_bishops ? 1 : 0) << data_shifts::opposite_bishops;
+	data |= 1ull << data_shifts::valid;
+
+	e.data = data;
+	e.endgame = ret.endgame;
+	e.key = key_word( piece_sum, data, ret.endgame );
+
+	return ret;
+}
+
+
+void clear()
+{
+	memset( table, 0, sizeof(table) );
+}
+
+}
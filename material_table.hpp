@@ -0,0 +1,51 @@
+#ifndef __MATERIAL_TABLE_H__
+#define __MATERIAL_TABLE_H__
+
+#include "endgame.hpp"
+#include "score.hpp"
+
+/*
+ * Everything in the evaluation that only depends on the material
+ * configuration, i.e. on position::piece_sum.
+ */
+class material_entry
+{
+public:
+	material_entry();
+
+	score imbalance;
+
+	// Specialized evaluation of the material configuration, 0 if there is none.
+	endgame_function endgame;
+
+	// The evaluation gets multiplied by scale / 2, indexed by the leading side.
+	unsigned char scale[2];
+
+	// If set, the evaluation gets halved if the bishops of the two sides are
+	// on squares of different color.
+	bool opposite_bishops;
+};
+
+/*
+ * Cache of material entries, so that getting one is a single probe per
+ * evaluation.
+ *
+ * There is only a single table shared by all threads. A search only sees
+ * few different material configurations, so entries hardly ever get written
+ * once the table is warmed up. Same as in the transposition table, entries
+ * use the xor technique for lockless access.
+ */
+namespace material_table {
+
+material_entry probe( uint64_t piece_sum );
+
+// Computes an entry without looking at the table.
+material_entry compute( uint64_t piece_sum );
+
+// Entries depend on the evaluation values, needs to be called after
+// changing them.
+void clear();
+
+}
+
+#endif
@@ -0,0 +1,282 @@
+/*
+ * Times the hot kernels of the engine in isolation, each over all positions
+ * of test/testpositions.txt, to tell which of them a regression came from.
+ *
+ * Usage: microbench [options] [kernel]
+ *
+ * Takes the same options as octochess, --memory sets the size of the
+ * transposition table. If a kernel name is given, only kernels whose name
+ * starts with it are run.
+ *
+ * Each kernel is run once to warm up the caches, then several more times.
+ * Reported are median, minimum and maximum time per operation over these
+ * runs. The spread between minimum and maximum shows how much to trust the
+ * median.
+ */
+#include "config.hpp"
+#include "detect_check.hpp"
+#include "eval.hpp"
+#include "eval_values.hpp"
+#include "fen.hpp"
+#include "hash.hpp"
+#include "magic.hpp"
+#include "moves.hpp"
+#include "pawn_structure_hash_table.hpp"
+#include "see.hpp"
+#include "util.hpp"
+#include "util/time.hpp"
+#include "zobrist.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+int const runs = 9;
+
+// Results of the kernels get summed up in here, so that the compiler cannot
+// optimize them away.
+uint64_t volatile sink = 0;
+
+struct corpus {
+	std::vector<position> positions;
+
+	// Legal moves of each position, and all of them in one list
+	std::vector<std::vector<move>> moves;
+	std::vector<std::pair<std::size_t, move>> all_moves;
+
+	// Positions not in check, needed by the capture generator
+	std::vector<std::size_t> not_in_check;
+
+	// Occupancy of each position
+	std::vector<uint64_t> occupancy;
+
+	// Keys of all positions after one move
+	std::vector<uint64_t> child_keys;
+};
+
+bool load_corpus( config const& conf, corpus& c )
+{
+	std::ifstream in_fen( conf.self_dir + "test/testpositions.txt" );
+	std::string fen;
+	while( std::getline( in_fen, fen ) ) {
+		position p;
+		if( !parse_fen( conf, fen, p ) ) {
+			continue;
+		}
+
+		check_map check( p );
+		std::size_t const index = c.positions.size();
+		c.positions.push_back( p );
+		c.moves.push_back( calculate_moves<movegen_type::all>( p, check ) );
+		if( !check.check ) {
+			c.not_in_check.push_back( index );
+		}
+		c.occupancy.push_back( p.bitboards[color::white][bb_type::all_pieces] | p.bitboards[color::black][bb_type::all_pieces] );
+
+		for( auto const& m : c.moves.back() ) {
+			c.all_moves.push_back( std::make_pair( index, m ) );
+
+			position child( p );
+			apply_move( child, m );
+			c.child_keys.push_back( child.hash_ );
+		}
+	}
+
+	return !c.positions.empty();
+}
+
+template<typename Kernel>
+void run( std::string const& filter, std::string const& name, uint64_t ops, Kernel const& kernel )
+{
+	if( name.compare( 0, filter.size(), filter ) || !ops ) {
+		return;
+	}
+
+	// Warm-up
+	sink = sink + kernel();
+
+	std::vector<double> ns;
+	for( int i = 0; i < runs; ++i ) {
+		timestamp start;
+		sink = sink + kernel();
+		duration elapsed = timestamp() - start;
+		ns.push_back( static_cast<double>(elapsed.picoseconds()) / 1000 / ops );
+	}
+	std::sort( ns.begin(), ns.end() );
+
+	double const median = ns[runs / 2];
+	std::stringstream ss;
+	ss << std::left << std::setw(24) << name << std::right << std::setw(10) << ops << std::fixed << std::setprecision(2)
+	   << std::setw(10) << median << std::setw(10) << ns.front() << std::setw(10) << ns.back();
+	if( median > 0 ) {
+		ss << std::setw(8) << std::setprecision(1) << (ns.back() - ns.front()) / median * 100 << "%";
+	}
+	ss << std::endl;
+	std::cout << ss.str();
+}
+
+template<movegen_type type>
+uint64_t movegen( corpus const& c, std::vector<std::size_t> const& indexes )
+{
+	move_info moves[256];
+	uint64_t n = 0;
+	for( auto i : indexes ) {
+		position const& p = c.positions[i];
+		check_map check( p );
+		move_info* end = moves;
+		calculate_moves<type>( p, end, check );
+		n += end - moves;
+	}
+	return n;
+}
+}
+
+int main( int argc, char const* argv[] )
+{
+	config conf;
+	std::string const filter = conf.init( argc, argv );
+
+	init_magic();
+	pst.init();
+	eval_values::init();
+	init_zobrist_tables();
+
+	corpus c;
+	if( !load_corpus( conf, c ) ) {
+		std::cerr << "Could not read test positions" << std::endl;
+		return 1;
+	}
+
+	std::vector<std::size_t> all_positions;
+	for( std::size_t i = 0; i < c.positions.size(); ++i ) {
+		all_positions.push_back( i );
+	}
+
+	std::vector<std::pair<std::size_t, move>> captures;
+	for( auto const& m : c.all_moves ) {
+		if( c.positions[m.first].get_captured_piece( m.second ) ) {
+			captures.push_back( m );
+		}
+	}
+
+	pawn_structure_hash_table pawn_tt;
+	pawn_tt.init( conf );
+
+	unsigned int const tt_size = conf.memory_given ? conf.memory : 64;
+	hash tt;
+	tt.init( tt_size );
+
+	std::cout << c.positions.size() << " positions, " << c.all_moves.size() << " moves, " << tt_size << " MB transposition table, "
+			  << slider_lookup_name( get_slider_lookup() ) << " slider lookups" << std::endl << std::endl;
+	std::cout << "Kernel                         ops    median       min       max  spread" << std::endl;
+	std::cout << "                                       ns/op     ns/op     ns/op" << std::endl;
+
+	run( filter, "check_map", c.positions.size(), [&]() {
+		uint64_t n = 0;
+		for( auto const& p : c.positions ) {
+			check_map check( p );
+			n += check.check;
+		}
+		return n;
+	} );
+
+	run( filter, "movegen all", all_positions.size(), [&]() {
+		return movegen<movegen_type::all>( c, all_positions );
+	} );
+	run( filter, "movegen capture", c.not_in_check.size(), [&]() {
+		return movegen<movegen_type::capture>( c, c.not_in_check );
+	} );
+	run( filter, "movegen noncapture", all_positions.size(), [&]() {
+		return movegen<movegen_type::noncapture>( c, all_positions );
+	} );
+	run( filter, "movegen pseudocheck", c.not_in_check.size(), [&]() {
+		return movegen<movegen_type::pseudocheck>( c, c.not_in_check );
+	} );
+
+	run( filter, "apply_move copy", c.all_moves.size(), [&]() {
+		uint64_t n = 0;
+		for( auto const& m : c.all_moves ) {
+			position p( c.positions[m.first] );
+			apply_move( p, m.second );
+			n += p.hash_;
+		}
+		return n;
+	} );
+
+	run( filter, "apply_move/undo_move", c.all_moves.size(), [&]() {
+		uint64_t n = 0;
+		for( std::size_t i = 0; i < c.positions.size(); ++i ) {
+			position& p = c.positions[i];
+			for( auto const& m : c.moves[i] ) {
+				move_undo undo;
+				apply_move( p, m, undo );
+				n += p.hash_;
+				undo_move( p, m, undo );
+			}
+		}
+		return n;
+	} );
+
+	run( filter, "evaluate_full", c.positions.size(), [&]() {
+		uint64_t n = 0;
+		for( auto const& p : c.positions ) {
+			n += evaluate_full( pawn_tt, p );
+		}
+		return n;
+	} );
+
+	run( filter, "see", captures.size(), [&]() {
+		uint64_t n = 0;
+		for( auto const& m : captures ) {
+			n += see( c.positions[m.first], m.second );
+		}
+		return n;
+	} );
+
+	// Every square for the occupancy of each position
+	run( filter, "rook_magic", c.occupancy.size() * 64, [&]() {
+		uint64_t n = 0;
+		for( auto occ : c.occupancy ) {
+			for( uint64_t sq = 0; sq < 64; ++sq ) {
+				n += rook_magic( sq, occ );
+			}
+		}
+		return n;
+	} );
+	run( filter, "bishop_magic", c.occupancy.size() * 64, [&]() {
+		uint64_t n = 0;
+		for( auto occ : c.occupancy ) {
+			for( uint64_t sq = 0; sq < 64; ++sq ) {
+				n += bishop_magic( sq, occ );
+			}
+		}
+		return n;
+	} );
+
+	// The keys of all child positions, spread over much more of the table
+	// than fits into the caches, as in a search.
+	run( filter, "hash store", c.child_keys.size(), [&]() {
+		for( std::size_t i = 0; i < c.child_keys.size(); ++i ) {
+			short const eval = static_cast<short>(i % 200) - 100;
+			tt.store( c.child_keys[i], static_cast<unsigned short>(i % 20), 0, eval, -50, 50, move(), 0, eval );
+		}
+		return uint64_t();
+	} );
+	run( filter, "hash lookup", c.child_keys.size(), [&]() {
+		uint64_t n = 0;
+		for( auto key : c.child_keys ) {
+			short eval = 0;
+			short full_eval = 0;
+			move best;
+			n += tt.lookup( key, 0, 0, -50, 50, eval, best, full_eval );
+		}
+		return n;
+	} );
+
+	return 0;
+}
@@ -0,0 +1,635 @@
+#include "nnue.hpp"
+#include "random.hpp"
+#include "util/platform.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NNUE_X86 1
+#define NNUE_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define NNUE_X86 1
+#define NNUE_TARGET(isa)
+#include <immintrin.h>
+#else
+#define NNUE_X86 0
+#endif
+
+namespace nnue {
+
+namespace {
+uint32_t const file_version = 1;
+char const file_magic[8] = { 'O', 'C', 'T', 'O', 'N', 'N', 'U', 'E' };
+
+int const hidden_shift = 6;
+int const output_divisor = 16;
+
+// Keep clear of mate scores
+short const max_eval = result::win_threshold - 1;
+
+struct network {
+	int16_t ft_weights[feature_count * accumulator_size];
+	int16_t ft_biases[accumulator_size];
+	int8_t l1_weights[hidden_size * 2 * accumulator_size];
+	int32_t l1_biases[hidden_size];
+	int8_t out_weights[hidden_size];
+	int32_t out_bias;
+};
+
+network net;
+bool loaded = false;
+
+// See evaluator_id()
+uint64_t net_id = 0;
+std::string loaded_file;
+bool enabled_ = false;
+
+// Index of the feature seen from the given perspective, pc encoded as in
+// accumulator_stack::entry.
+inline int feature( int perspective, unsigned short pc )
+{
+	int const c = pc / 384;
+	int const piece = (pc / 64) % 6;
+	int const sq = pc % 64;
+
+	return ((c == perspective ? 0 : 6) + piece) * 64 + (perspective == color::white ? sq : sq ^ 56);
+}
+
+inline unsigned short piece_square( color::type c, pieces::type piece, int sq )
+{
+	return static_cast<unsigned short>(c * 384 + (piece - 1) * 64 + sq);
+}
+
+inline int clamp( int v, int min, int max )
+{
+	return v < min ? min : (v > max ? max : v);
+}
+
+
+// out = in + sum of added feature rows - sum of removed feature rows
+typedef void (*update_function)( int16_t* out, int16_t const* in, int16_t const* const* added, int added_count, int16_t const* const* removed, int removed_count );
+
+// Evaluates the hidden and output layers
+typedef int32_t (*propagate_function)( int16_t const* us, int16_t const* them );
+
+struct kernel_set {
+	update_function update;
+	propagate_function propagate;
+};
+
+
+void update_scalar( int16_t* out, int16_t const* in, int16_t const* const* added, int added_count, int16_t const* const* removed, int removed_count )
+{
+	for( int i = 0; i < accumulator_size; ++i ) {
+		int v = in[i];
+		for( int j = 0; j < added_count; ++j ) {
+			v += added[j][i];
+		}
+		for( int j = 0; j < removed_count; ++j ) {
+			v -= removed[j][i];
+		}
+		out[i] = static_cast<int16_t>(v);
+	}
+}
+
+int32_t propagate_scalar( int16_t const* us, int16_t const* them )
+{
+	uint8_t input[2 * accumulator_size];
+	for( int i = 0; i < accumulator_size; ++i ) {
+		input[i] = static_cast<uint8_t>(clamp( us[i], 0, 127 ));
+		input[accumulator_size + i] = static_cast<uint8_t>(clamp( them[i], 0, 127 ));
+	}
+
+	int32_t out = net.out_bias;
+	for( int j = 0; j < hidden_size; ++j ) {
+		int8_t const* w = net.l1_weights + j * 2 * accumulator_size;
+		int32_t sum = net.l1_biases[j];
+		for( int i = 0; i < 2 * accumulator_size; ++i ) {
+			sum += w[i] * input[i];
+		}
+		out += net.out_weights[j] * clamp( sum >> hidden_shift, 0, 127 );
+	}
+
+	return out;
+}
+
+
+#if NNUE_X86
+NNUE_TARGET("sse4.1")
+void update_sse41( int16_t* out, int16_t const* in, int16_t const* const* added, int added_count, int16_t const* const* removed, int removed_count )
+{
+	for( int i = 0; i < accumulator_size; i += 8 ) {
+		__m128i v = _mm_loadu_si128( reinterpret_cast<__m128i const*>(in + i) );
+		for( int j = 0; j < added_count; ++j ) {
+			v = _mm_add_epi16( v, _mm_loadu_si128( reinterpret_cast<__m128i const*>(added[j] + i) ) );
+		}
+		for( int j = 0; j < removed_count; ++j ) {
+			v = _mm_sub_epi16( v, _mm_loadu_si128( reinterpret_cast<__m128i const*>(removed[j] + i) ) );
+		}
+		_mm_storeu_si128( reinterpret_cast<__m128i*>(out + i), v );
+	}
+}
+
+NNUE_TARGET("sse4.1")
+void transform_sse41( uint8_t* out, int16_t const* in )
+{
+	__m128i const zero = _mm_setzero_si128();
+	for( int i = 0; i < accumulator_size; i += 16 ) {
+		__m128i const a = _mm_loadu_si128( reinterpret_cast<__m128i const*>(in + i) );
+		__m128i const b = _mm_loadu_si128( reinterpret_cast<__m128i const*>(in + i + 8) );
+		__m128i const v = _mm_max_epi8( _mm_packs_epi16( a, b ), zero );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>(out + i), v );
+	}
+}
+
+NNUE_TARGET("sse4.1")
+int32_t propagate_sse41( int16_t const* us, int16_t const* them )
+{
+	uint8_t input[2 * accumulator_size];
+	transform_sse41( input, us );
+	transform_sse41( input + accumulator_size, them );
+
+	// The products of the inputs in [0, 127] and the weights cannot saturate
+	// the pairwise 16bit sums of maddubs.
+	__m128i const ones = _mm_set1_epi16( 1 );
+
+	int32_t out = net.out_bias;
+	for( int j = 0; j < hidden_size; ++j ) {
+		int8_t const* w = net.l1_weights + j * 2 * accumulator_size;
+		__m128i sum = _mm_setzero_si128();
+		for( int i = 0; i < 2 * accumulator_size; i += 16 ) {
+			__m128i const x = _mm_loadu_si128( reinterpret_cast<__m128i const*>(input + i) );
+			__m128i const y = _mm_loadu_si128( reinterpret_cast<__m128i const*>(w + i) );
+			sum = _mm_add_epi32( sum, _mm_madd_epi16( _mm_maddubs_epi16( x, y ), ones ) );
+		}
+		sum = _mm_add_epi32( sum, _mm_shuffle_epi32( sum, 0x4e ) );
+		sum = _mm_add_epi32( sum, _mm_shuffle_epi32( sum, 0xb1 ) );
+
+		int32_t const v = _mm_cvtsi128_si32( sum ) + net.l1_biases[j];
+		out += net.out_weights[j] * clamp( v >> hidden_shift, 0, 127 );
+	}
+
+	return out;
+}
+
+
+NNUE_TARGET("avx2")
+void update_avx2( int16_t* out, int16_t const* in, int16_t const* const* added, int added_count, int16_t const* const* removed, int removed_count )
+{
+	for( int i = 0; i < accumulator_size; i += 16 ) {
+		__m256i v = _mm256_loadu_si256( reinterpret_cast<__m256i const*>(in + i) );
+		for( int j = 0; j < added_count; ++j ) {
+			v = _mm256_add_epi16( v, _mm256_loadu_si256( reinterpret_cast<__m256i const*>(added[j] + i) ) );
+		}
+		for( int j = 0; j < removed_count; ++j ) {
+			v = _mm256_sub_epi16( v, _mm256_loadu_si256( reinterpret_cast<__m256i const*>(removed[j] + i) ) );
+		}
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>(out + i), v );
+	}
+}
+
+NNUE_TARGET("avx2")
+void transform_avx2( uint8_t* out, int16_t const* in )
+{
+	__m256i const zero = _mm256_setzero_si256();
+	for( int i = 0; i < accumulator_size; i += 32 ) {
+		__m256i const a = _mm256_loadu_si256( reinterpret_cast<__m256i const*>(in + i) );
+		__m256i const b = _mm256_loadu_si256( reinterpret_cast<__m256i const*>(in + i + 16) );
+
+		// Packing works per 128bit lane, restore the order afterwards.
+		__m256i const v = _mm256_max_epi8( _mm256_permute4x64_epi64( _mm256_packs_epi16( a, b ), 0xd8 ), zero );
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>(out + i), v );
+	}
+}
+
+NNUE_TARGET("avx2")
+int32_t propagate_avx2( int16_t const* us, int16_t const* them )
+{
+	uint8_t input[2 * accumulator_size];
+	transform_avx2( input, us );
+	transform_avx2( input + accumulator_size, them );
+
+	__m256i const ones = _mm256_set1_epi16( 1 );
+
+	int32_t out = net.out_bias;
+	for( int j = 0; j < hidden_size; ++j ) {
+		int8_t const* w = net.l1_weights + j * 2 * accumulator_size;
+		__m256i sum = _mm256_setzero_si256();
+		for( int i = 0; i < 2 * accumulator_size; i += 32 ) {
+			__m256i const x = _mm256_loadu_si256( reinterpret_cast<__m256i const*>(input + i) );
+			__m256i const y = _mm256_loadu_si256( reinterpret_cast<__m256i const*>(w + i) );
+			sum = _mm256_add_epi32( sum, _mm256_madd_epi16( _mm256_maddubs_epi16( x, y ), ones ) );
+		}
+		__m128i s = _mm_add_epi32( _mm256_castsi256_si128( sum ), _mm256_extracti128_si256( sum, 1 ) );
+		s = _mm_add_epi32( s, _mm_shuffle_epi32( s, 0x4e ) );
+		s = _mm_add_epi32( s, _mm_shuffle_epi32( s, 0xb1 ) );
+
+		int32_t const v = _mm_cvtsi128_si32( s ) + net.l1_biases[j];
+		out += net.out_weights[j] * clamp( v >> hidden_shift, 0, 127 );
+	}
+
+	return out;
+}
+
+kernel_set const kernel_sets[] = {
+	{ update_scalar, propagate_scalar },
+	{ update_sse41, propagate_sse41 },
+	{ update_avx2, propagate_avx2 }
+};
+#else
+kernel_set const kernel_sets[] = {
+	{ update_scalar, propagate_scalar },
+	{ update_scalar, propagate_scalar },
+	{ update_scalar, propagate_scalar }
+};
+#endif
+
+simd::type current_simd = best_simd();
+kernel_set const* kernels = &kernel_sets[current_simd];
+
+
+void refresh( int16_t (&acc)[2][accumulator_size], position const& p )
+{
+	for( int perspective = 0; perspective < 2; ++perspective ) {
+		int16_t const* added[32];
+		int count = 0;
+		for( int c = 0; c < 2; ++c ) {
+			for( int piece = pieces::pawn; piece <= pieces::king; ++piece ) {
+				uint64_t bb = p.bitboards[c][piece];
+				while( bb ) {
+					uint64_t sq = bitscan_unset( bb );
+					int const f = feature( perspective, piece_square( static_cast<color::type>(c), static_cast<pieces::type>(piece), static_cast<int>(sq) ) );
+					added[count++] = net.ft_weights + f * accumulator_size;
+				}
+			}
+		}
+		kernels->update( acc[perspective], net.ft_biases, added, count, 0, 0 );
+	}
+}
+
+short to_eval( int32_t out )
+{
+	return static_cast<short>(clamp( out / output_divisor, -max_eval, max_eval ));
+}
+
+
+// FNV-1a over the weights, never 0
+uint64_t checksum( network const& n )
+{
+	unsigned char const* p = reinterpret_cast<unsigned char const*>(&n);
+	uint64_t h = 0xcbf29ce484222325ull;
+	for( std::size_t i = 0; i < sizeof(n); ++i ) {
+		h ^= p[i];
+		h *= 0x100000001b3ull;
+	}
+	return h ? h : 1;
+}
+
+template<typename T>
+bool read( std::istream& in, T* data, std::size_t count )
+{
+	in.read( reinterpret_cast<char*>(data), sizeof(T) * count );
+	return static_cast<bool>(in);
+}
+
+template<typename T>
+void write( std::ostream& out, T const* data, std::size_t count )
+{
+	out.write( reinterpret_cast<char const*>(data), sizeof(T) * count );
+}
+}
+
+
+bool load( std::string const& file )
+{
+	std::ifstream in( file.c_str(), std::ifstream::in | std::ifstream::binary );
+	if( !in.is_open() ) {
+		std::cerr << "Could not open network file " << file << std::endl;
+		return false;
+	}
+
+	std::string error;
+	if( !load( in, &error ) ) {
+		std::cerr << "Could not load network file " << file << ": " << error << std::endl;
+		return false;
+	}
+
+	loaded_file = file;
+	return true;
+}
+
+
+bool load( std::istream& in, std::string* error )
+{
+	// The weights are stored little endian, same as in memory on all
+	// supported platforms.
+	char magic[sizeof(file_magic)];
+	uint32_t header[4];
+	if( !read( in, magic, sizeof(magic) ) || !read( in, header, 4 ) ) {
+		if( error ) {
+			*error = "truncated";
+		}
+		return false;
+	}
+	if( memcmp( magic, file_magic, sizeof(magic) ) || header[0] != file_version ) {
+		if( error ) {
+			*error = "not a network file or unsupported version";
+		}
+		return false;
+	}
+	if( header[1] != feature_count || header[2] != accumulator_size || header[3] != hidden_size ) {
+		if( error ) {
+			*error = "unsupported network dimensions";
+		}
+		return false;
+	}
+
+	std::unique_ptr<network> n( new network );
+	if( !read( in, n->ft_weights, sizeof(n->ft_weights) / sizeof(int16_t) ) ||
+		!read( in, n->ft_biases, accumulator_size ) ||
+		!read( in, n->l1_weights, sizeof(n->l1_weights) ) ||
+		!read( in, n->l1_biases, hidden_size ) ||
+		!read( in, n->out_weights, hidden_size ) ||
+		!read( in, &n->out_bias, 1 ) )
+	{
+		if( error ) {
+			*error = "truncated";
+		}
+		return false;
+	}
+	if( in.peek() != std::istream::traits_type::eof() ) {
+		if( error ) {
+			*error = "trailing data";
+		}
+		return false;
+	}
+
+	net = *n;
+	net_id = checksum( net );
+	loaded = true;
+	loaded_file.clear();
+
+	return true;
+}
+
+
+bool save( std::ostream& out )
+{
+	if( !loaded ) {
+		return false;
+	}
+
+	uint32_t const header[4] = { file_version, feature_count, accumulator_size, hidden_size };
+	write( out, file_magic, sizeof(file_magic) );
+	write( out, header, 4 );
+	write( out, net.ft_weights, sizeof(net.ft_weights) / sizeof(int16_t) );
+	write( out, net.ft_biases, accumulator_size );
+	write( out, net.l1_weights, sizeof(net.l1_weights) );
+	write( out, net.l1_biases, hidden_size );
+	write( out, net.out_weights, hidden_size );
+	write( out, &net.out_bias, 1 );
+
+	return static_cast<bool>(out);
+}
+
+
+void randomize( uint64_t seed )
+{
+	// Scaled such that most neurons are neither always zero nor always saturated
+	randgen rng( seed );
+	for( int i = 0; i < feature_count * accumulator_size; ++i ) {
+		net.ft_weights[i] = static_cast<int16_t>(static_cast<int>(rng.get_uint64() % 64) - 32);
+	}
+	for( int i = 0; i < accumulator_size; ++i ) {
+		net.ft_biases[i] = static_cast<int16_t>(rng.get_uint64() % 64);
+	}
+	for( int i = 0; i < hidden_size * 2 * accumulator_size; ++i ) {
+		net.l1_weights[i] = static_cast<int8_t>(static_cast<int>(rng.get_uint64() % 16) - 8);
+	}
+	for( int i = 0; i < hidden_size; ++i ) {
+		net.l1_biases[i] = static_cast<int32_t>(rng.get_uint64() % 4096) - 2048;
+		net.out_weights[i] = static_cast<int8_t>(static_cast<int>(rng.get_uint64() % 64) - 32);
+	}
+	net.out_bias = 0;
+
+	net_id = checksum( net );
+	loaded = true;
+	loaded_file.clear();
+}
+
+
+bool init( config const& conf )
+{
+	if( !conf.nnue_file.empty() && conf.nnue_file != loaded_file ) {
+		std::string file = conf.nnue_file;
+		if( !std::ifstream( file.c_str() ) && std::ifstream( (conf.self_dir + file).c_str() ) ) {
+			// Relative to the program directory
+			file = conf.self_dir + file;
+		}
+		if( !load( file ) ) {
+			enabled_ = false;
+			return false;
+		}
+		loaded_file = conf.nnue_file;
+	}
+
+	if( conf.use_nnue && !loaded ) {
+		std::cerr << "No network loaded, using the hand-crafted evaluation" << std::endl;
+		enabled_ = false;
+		return false;
+	}
+
+	enabled_ = conf.use_nnue;
+	return true;
+}
+
+
+bool enabled()
+{
+	return enabled_;
+}
+
+
+uint64_t evaluator_id()
+{
+	return enabled_ ? net_id : 0;
+}
+
+
+bool set_enabled( bool enable )
+{
+	if( enable && !loaded ) {
+		return false;
+	}
+	enabled_ = enable;
+	return true;
+}
+
+
+bool cpu_supports( simd::type t )
+{
+#if NNUE_X86
+	switch( t ) {
+	case simd::avx2:
+		return cpu_has_avx2();
+	case simd::sse41:
+		return cpu_has_sse41();
+	default:
+		return true;
+	}
+#else
+	return t == simd::scalar;
+#endif
+}
+
+
+simd::type best_simd()
+{
+	if( cpu_supports( simd::avx2 ) ) {
+		return simd::avx2;
+	}
+	if( cpu_supports( simd::sse41 ) ) {
+		return simd::sse41;
+	}
+	return simd::scalar;
+}
+
+
+simd::type get_simd()
+{
+	return current_simd;
+}
+
+
+bool set_simd( simd::type t )
+{
+	if( !cpu_supports( t ) ) {
+		return false;
+	}
+	current_simd = t;
+	kernels = &kernel_sets[t];
+	return true;
+}
+
+
+char const* simd_name( simd::type t )
+{
+	switch( t ) {
+	case simd::avx2:
+		return "avx2";
+	case simd::sse41:
+		return "sse4.1";
+	default:
+		return "scalar";
+	}
+}
+
+
+short evaluate( position const& p )
+{
+	int16_t acc[2][accumulator_size];
+	refresh( acc, p );
+	return to_eval( kernels->propagate( acc[p.self()], acc[p.other()] ) );
+}
+
+
+accumulator_stack::accumulator_stack()
+	: top_(entries_)
+	, active_()
+{
+}
+
+
+void accumulator_stack::reset( position const& p )
+{
+	active_ = enabled_;
+	top_ = entries_;
+	if( active_ ) {
+		refresh( top_->v, p );
+		top_->computed = true;
+	}
+}
+
+
+void accumulator_stack::do_push( position const& p, move const& m )
+{
+	ASSERT( top_ + 1 < entries_ + sizeof(entries_) / sizeof(entry) );
+	entry& e = *++top_;
+	e.computed = false;
+
+	color::type const c = p.self();
+	pieces::type const piece = p.get_piece( m.source() );
+
+	if( m.castle() ) {
+		bool const kingside = (m.target() % 8) == 6;
+		uint64_t const rook = kingside ? bitscan_reverse( p.castle[c] ) : bitscan( p.castle[c] );
+		int const row = p.white() ? 0 : 56;
+
+		e.removed_count = 2;
+		e.removed[0] = piece_square( c, pieces::king, m.source() );
+		e.removed[1] = piece_square( c, pieces::rook, row + static_cast<int>(rook) );
+		e.added_count = 2;
+		e.added[0] = piece_square( c, pieces::king, m.target() );
+		e.added[1] = piece_square( c, pieces::rook, row + (kingside ? 5 : 3) );
+		return;
+	}
+
+	e.removed_count = 1;
+	e.removed[0] = piece_square( c, piece, m.source() );
+
+	pieces::type const captured = p.get_captured_piece( m );
+	if( captured != pieces::none ) {
+		int const sq = m.enpassant() ? ((m.target() & 0x7) | (m.source() & 0x38)) : m.target();
+		e.removed[e.removed_count++] = piece_square( p.other(), captured, sq );
+	}
+
+	e.added_count = 1;
+	e.added[0] = piece_square( c, m.promotion() ? m.promotion_piece() : piece, m.target() );
+}
+
+
+short accumulator_stack::evaluate( position const& p )
+{
+	ASSERT( active_ );
+
+	if( !top_->computed ) {
+		// Find the last computed entry. The first entry always is.
+		entry* e = top_;
+		int cost = 0;
+		while( !e->computed ) {
+			cost += e->removed_count + e->added_count;
+			--e;
+		}
+
+		if( cost > static_cast<int>(popcount( p.bitboards[0][bb_type::all_pieces] | p.bitboards[1][bb_type::all_pieces] )) ) {
+			// Too far back, cheaper to start over
+			refresh( top_->v, p );
+		}
+		else {
+			for( ++e; e <= top_; ++e ) {
+				entry const& prev = *(e - 1);
+				for( int perspective = 0; perspective < 2; ++perspective ) {
+					int16_t const* added[2];
+					int16_t const* removed[2];
+					for( int i = 0; i < e->added_count; ++i ) {
+						added[i] = net.ft_weights + feature( perspective, e->added[i] ) * accumulator_size;
+					}
+					for( int i = 0; i < e->removed_count; ++i ) {
+						removed[i] = net.ft_weights + feature( perspective, e->removed[i] ) * accumulator_size;
+					}
+					kernels->update( e->v[perspective], prev.v[perspective], added, e->added_count, removed, e->removed_count );
+				}
+				e->computed = true;
+			}
+		}
+		top_->computed = true;
+	}
+
+	return to_eval( kernels->propagate( top_->v[p.self()], top_->v[p.other()] ) );
+}
+
+}
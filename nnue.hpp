@@ -0,0 +1,144 @@
+#ifndef __NNUE_H__
+#define __NNUE_H__
+
+#include "assert.hpp"
+#include "config.hpp"
+#include "move.hpp"
+#include "position.hpp"
+
+#include <iosfwd>
+#include <string>
+
+/*
+ * Optional neural network evaluation, used by evaluate_full instead of the
+ * hand-crafted evaluation if enabled.
+ *
+ * The network is small and integer-quantized:
+ * - 768 input features: Piece type and color relative to the perspective,
+ *   times the square seen from the perspective. Black's view is mirrored
+ *   vertically.
+ * - The feature transformer: 256 int16 neurons per perspective, the
+ *   accumulators. As only a few features change with a move, they can be
+ *   updated incrementally.
+ * - Both accumulators, side to move first, clamped to [0, 127], feed into
+ *   32 hidden neurons with int8 weights. Their sums are divided by 64 and
+ *   clamped to [0, 127] again.
+ * - A single output neuron with int8 weights, divided by 16 to get the
+ *   evaluation in centipawns from the side to move's point of view.
+ *
+ * The network file, all values little endian:
+ *   "OCTONNUE", uint32 version (1), uint32 feature count (768),
+ *   uint32 accumulator size (256), uint32 hidden size (32),
+ *   int16 feature weights[768][256], int16 feature biases[256],
+ *   int8 hidden weights[32][512], int32 hidden biases[32],
+ *   int8 output weights[32], int32 output bias
+ */
+namespace nnue {
+
+int const feature_count = 2 * 6 * 64;
+int const accumulator_size = 256;
+int const hidden_size = 32;
+
+// Inference kernels, the best one the CPU supports is used by default.
+namespace simd {
+enum type {
+	scalar,
+	sse41,
+	avx2
+};
+}
+
+// Loads the network. On failure the current network is kept.
+bool load( std::string const& file );
+bool load( std::istream& in, std::string* error = 0 );
+bool save( std::ostream& out );
+
+// Fills the network with pseudo-random weights, for tests and benchmarks.
+void randomize( uint64_t seed );
+
+// Loads conf.nnue_file if not yet loaded and enables or disables the
+// network according to conf.use_nnue. Returns false if the network
+// was requested but could not be loaded.
+bool init( config const& conf );
+
+bool enabled();
+
+// Identifies the evaluation in use: 0 for the hand-crafted one, else a
+// checksum of the network's weights.
+uint64_t evaluator_id();
+
+// Fails if no network has been loaded.
+bool set_enabled( bool enable );
+
+bool cpu_supports( simd::type t );
+simd::type best_simd();
+simd::type get_simd();
+bool set_simd( simd::type t );
+char const* simd_name( simd::type t );
+
+// Evaluates the position from scratch, from the side to move's point of view.
+short evaluate( position const& p );
+
+/*
+ * Accumulators along the current line of the search, one entry per ply.
+ *
+ * push records the features a move changes, the accumulators themselves are
+ * only updated when a position gets evaluated, starting from the last entry
+ * that has been computed. Positions that never get evaluated, e.g. due
+ * to a hit in the evaluation cache or the transposition table, cost next
+ * to nothing.
+ *
+ * Null moves do not change any feature and need no entry.
+ */
+class accumulator_stack
+{
+public:
+	accumulator_stack();
+
+	// Starts a new line at the given position. Picks up whether the network
+	// is enabled, if not, all other functions do nothing.
+	void reset( position const& p );
+
+	bool active() const { return active_; }
+
+	// Needs to be called before the move is applied to the position.
+	void push( position const& p, move const& m ) {
+		if( active_ ) {
+			do_push( p, m );
+		}
+	}
+
+	void pop() {
+		if( active_ ) {
+			ASSERT( top_ != entries_ );
+			--top_;
+		}
+	}
+
+	// p must be the position of the current entry.
+	short evaluate( position const& p );
+
+private:
+	struct entry {
+		int16_t v[2][accumulator_size];
+
+		bool computed;
+
+		// Pieces removed and added by the move, as color * 384 + (piece - 1) * 64 + square
+		unsigned char removed_count;
+		unsigned char added_count;
+		unsigned short removed[2];
+		unsigned short added[2];
+	};
+
+	void do_push( position const& p, move const& m );
+
+	entry entries_[MAX_DEPTH + MAX_QDEPTH + 2];
+	entry* top_;
+
+	bool active_;
+};
+
+}
+
+#endif
@@ -1,6 +1,8 @@
 #include "pawn_structure_hash_table.hpp"
 #include "assert.hpp"
 
+#include "util/thread.hpp"
+
 #include <string.h>
 #include <stdlib.h>
 
@@ -12,11 +14,18 @@ struct pawn_structure_hash_table::entry
 	uint64_t data3;
 };
 
+namespace {
+unsigned int const bucket_entries = 2;
+unsigned int const bucket_shift = 6;
+}
+
 
 pawn_structure_hash_table::pawn_structure_hash_table()
 	: data_()
+	, page_type_()
 	, key_mask_()
 	, init_size_()
+	, threads_(1)
 {
 }
 
@@ -39,16 +48,16 @@ bool pawn_structure_hash_table::init( uint64_t size_in_mib, bool reset )
 	}
 
 	while( !data_ && size_in_mib > 0 ) {
-		uint64_t size = 4;
+		uint64_t size = 1;
 		while( size * 2 <= size_in_mib ) {
 			size *= 2;
 		}
 		size *= 1024 * 1024;
 
-		data_ = reinterpret_cast<entry*>(page_aligned_malloc( size ) );
+		data_ = reinterpret_cast<entry*>(huge_page_malloc( size, page_type_ ) );
 		if( data_ ) {
-			memset(data_, 0, size);
-			key_mask_ = ((size/sizeof(entry)) - 1) << 5;
+			parallel_clear( data_, size, threads_ );
+			key_mask_ = ((size / (sizeof(entry) * bucket_entries)) - 1) << bucket_shift;
 		}
 		else {
 			size_in_mib /= 2;
@@ -59,6 +68,13 @@ bool pawn_structure_hash_table::init( uint64_t size_in_mib, bool reset )
 }
 
 
+bool pawn_structure_hash_table::init( config const& conf, bool reset )
+{
+	threads_ = conf.thread_count;
+	return init( conf.pawn_hash_table_size(), reset );
+}
+
+
 union uv1 {
 	uint64_t p;
 	struct {
@@ -70,14 +86,14 @@ union uv1 {
 };
 
 
-pawn_structure_hash_table::entry* pawn_structure_hash_table::get_entry( uint64_t key )
+pawn_structure_hash_table::entry* pawn_structure_hash_table::get_bucket( uint64_t key )
 {
 	uint64_t offset = key & key_mask_;
 	return reinterpret_cast<entry*>(reinterpret_cast<unsigned char*>(data_) + offset);
 }
 
 
-pawn_structure_hash_table::entry const* pawn_structure_hash_table::get_entry( uint64_t key ) const
+pawn_structure_hash_table::entry const* pawn_structure_hash_table::get_bucket( uint64_t key ) const
 {
 	uint64_t offset = key & key_mask_;
 	return reinterpret_cast<entry const*>(reinterpret_cast<unsigned char const*>(data_) + offset);
@@ -86,45 +102,52 @@ pawn_structure_hash_table::entry const* pawn_structure_hash_table::get_entry( ui
 
 void pawn_structure_hash_table::clear( uint64_t key )
 {
-	get_entry(key)->key = 0;
+	entry* bucket = get_bucket(key);
+	for( unsigned int i = 0; i < bucket_entries; ++i ) {
+		if( (bucket[i].data1 ^ bucket[i].data2 ^ bucket[i].key) == key ) {
+			bucket[i].key = 0;
+		}
+	}
 }
 
 
 bool pawn_structure_hash_table::lookup( uint64_t key, score* eval, uint64_t& passed ) const
 {
-	entry const* entry = get_entry(key);
-	
-	uv1 v1;
-	v1.p = entry->data1;
-	uint64_t v2 = entry->data2;
+	entry const* bucket = get_bucket(key);
 
-	uint64_t dk = entry->key;
+	for( unsigned int i = 0; i < bucket_entries; ++i ) {
+		uv1 v1;
+		v1.p = bucket[i].data1;
+		uint64_t v2 = bucket[i].data2;
 
-	if( (v1.p ^ v2 ^ dk) != key) {
-#if USE_STATISTICS >= 2
-		++stats_.misses;
-#endif
-		return false;
-	}
+		uint64_t dk = bucket[i].key;
 
-	eval[0].mg() = v1.s.mg0;
-	eval[1].mg() = v1.s.mg1;
-	eval[0].eg() = v1.s.eg0;
-	eval[1].eg() = v1.s.eg1;
+		if( (v1.p ^ v2 ^ dk) != key ) {
+			continue;
+		}
 
-	passed = v2;
+		eval[0] = score( v1.s.mg0, v1.s.eg0 );
+		eval[1] = score( v1.s.mg1, v1.s.eg1 );
+
+		passed = v2;
 
 #if USE_STATISTICS >= 2
-	++stats_.hits;
+		++stats_.hits;
 #endif
 
-	return true;
+		return true;
+	}
+
+#if USE_STATISTICS >= 2
+	++stats_.misses;
+#endif
+	return false;
 }
 
 
 void pawn_structure_hash_table::store( uint64_t key, score const* eval, uint64_t passed )
 {
-	entry* entry = get_entry(key);
+	entry* bucket = get_bucket(key);
 
 	uv1 v1;
 	v1.s.mg0 = eval[0].mg();
@@ -134,17 +157,29 @@ void pawn_structure_hash_table::store( uint64_t key, score const* eval, uint64_t
 
 	uint64_t v2 = passed;
 
-#if USE_STATISTICS >= 2
-	if( !entry->key ) {
-		++stats_.fill;
-	}
-	else {
-		++stats_.collision;
+	entry* e = bucket;
+	if( (bucket[1].data1 ^ bucket[1].data2 ^ bucket[1].key) == key ) {
+		e = bucket + 1;
 	}
+	else if( (bucket[0].data1 ^ bucket[0].data2 ^ bucket[0].key) != key ) {
+#if USE_STATISTICS >= 2
+		if( !bucket[1].key ) {
+			++stats_.fill;
+		}
+		else {
+			++stats_.collision;
+		}
 #endif
-	entry->data1 = v1.p;
-	entry->data2 = v2;
-	entry->key = v1.p ^ v2 ^ key;
+		// Age out the previous first entry. Copied as is, the xor still
+		// matches.
+		bucket[1].data1 = bucket[0].data1;
+		bucket[1].data2 = bucket[0].data2;
+		bucket[1].key = bucket[0].key;
+	}
+
+	e->data1 = v1.p;
+	e->data2 = v2;
+	e->key = v1.p ^ v2 ^ key;
 
 #if VERIFY_PAWN_HASH_TABLE
 	score ev2[2];
@@ -172,6 +207,6 @@ pawn_structure_hash_table::stats pawn_structure_hash_table::get_stats( bool rese
 
 uint64_t pawn_structure_hash_table::max_hash_entry_count() const
 {
-	return (key_mask_ >> 5) + 1;
+	return ((key_mask_ >> bucket_shift) + 1) * bucket_entries;
 }
 #endif
\ No newline at end of file
@@ -8,8 +8,10 @@
 /*
  * Hash table to hold the pawn structure evaluation.
  * The general idea is the following:
- * Naive hash structure using always-replace.
- * Entry size is a power of two, thus somewhat cache-friendly.
+ * Buckets of two entries, each bucket filling one cache line.
+ * Pawn entries have no depth to compare, replacement only goes by age: New
+ * entries go into the first slot, pushing the previous occupant into the
+ * second one. Whatever was in the second slot gets dropped.
  * Using Hyatt's lockless transposition table algorithm
  *
  * Key 64bit zobrist over pawns, white's point of view.
@@ -52,31 +54,47 @@ public:
 
 	bool init( uint64_t size_in_mib, bool reset = false );
 
-	// Pass array of two shorts
+	// Takes size and the number of threads used for clearing from the configuration.
+	bool init( config const& conf, bool reset = false );
+
+	// Pass array of two scores
 	bool lookup( uint64_t key, score* eval, uint64_t& passed ) const;
 
-	// Pass array of two shorts
+	// Pass array of two scores
 	void store( uint64_t key, score const* eval, uint64_t passed );
 
+	// Starts loading the bucket of the key into the cache.
+	void prefetch( uint64_t key ) const {
+		::prefetch( reinterpret_cast<unsigned char const*>(data_) + (key & key_mask_) );
+	}
+
 #if USE_STATISTICS >= 2
 	stats get_stats( bool reset );
 	uint64_t max_hash_entry_count() const;
 #endif
 
+	// Removes the entry of the given key, if any
 	void clear( uint64_t key );
 
+	page_type::type get_page_type() const { return page_type_; }
+
 private:
 
-	entry* get_entry( uint64_t key );
-	entry const* get_entry( uint64_t key ) const;
+	// Returns the first entry of the key's bucket
+	entry* get_bucket( uint64_t key );
+	entry const* get_bucket( uint64_t key ) const;
 
 #if USE_STATISTICS >= 2
 	mutable stats stats_;
 #endif
 
 	entry* data_;
+	page_type::type page_type_;
 	uint64_t key_mask_;
 	uint64_t init_size_;
+
+	// Number of threads clearing the table
+	unsigned int threads_;
 };
 
 #endif
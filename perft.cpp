@@ -0,0 +1,159 @@
+#include "perft.hpp"
+#include "detect_check.hpp"
+#include "moves.hpp"
+#include "util.hpp"
+#include "util/atomic.hpp"
+#include "util/thread.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+class perft_hash
+{
+public:
+	perft_hash( unsigned int megabytes, unsigned int thread_count )
+		: data_()
+		, mask_()
+	{
+		if( !megabytes ) {
+			return;
+		}
+
+		uint64_t count = 1;
+		while( count * 2 * sizeof(entry) <= static_cast<uint64_t>(megabytes) * 1024 * 1024 ) {
+			count *= 2;
+		}
+
+		data_ = reinterpret_cast<entry*>(page_aligned_malloc( count * sizeof(entry) ));
+		if( data_ ) {
+			parallel_clear( data_, count * sizeof(entry), thread_count );
+			mask_ = count - 1;
+		}
+	}
+
+	~perft_hash()
+	{
+		aligned_free( data_ );
+	}
+
+	bool lookup( uint64_t key, int depth, uint64_t& count ) const
+	{
+		if( !data_ ) {
+			return false;
+		}
+
+		entry const& e = data_[key & mask_];
+		uint64_t const v = e.v;
+		if( (e.key ^ v) != key || static_cast<int>(v & 0xff) != depth ) {
+			return false;
+		}
+
+		count = v >> 8;
+		return true;
+	}
+
+	void store( uint64_t key, int depth, uint64_t count )
+	{
+		if( !data_ ) {
+			return;
+		}
+
+		uint64_t const v = (count << 8) | static_cast<uint64_t>(depth);
+		entry& e = data_[key & mask_];
+		e.key = key ^ v;
+		e.v = v;
+	}
+
+private:
+	struct entry {
+		uint64_t key;
+
+		// Count in the upper 56 bits, remaining depth in the lower 8 bits.
+		uint64_t v;
+	};
+
+	entry* data_;
+	uint64_t mask_;
+};
+
+// At most 218 moves in any legal position
+unsigned int const max_moves_per_ply = 256;
+
+uint64_t perft( perft_hash& hash, move_info* moves, int depth, position& p )
+{
+	uint64_t n = 0;
+	if( depth > 1 && hash.lookup( p.hash_, depth, n ) ) {
+		return n;
+	}
+
+	check_map check( p );
+	move_info* end = moves;
+	calculate_moves<movegen_type::all>( p, end, check );
+
+	// Bulk counting at the last ply
+	if( depth == 1 ) {
+		return end - moves;
+	}
+
+	for( move_info* it = moves; it != end; ++it ) {
+		move_undo undo;
+		apply_move( p, it->m, undo );
+		n += perft( hash, end, depth - 1, p );
+		undo_move( p, it->m, undo );
+	}
+
+	hash.store( p.hash_, depth, n );
+	return n;
+}
+
+void collect_positions( position const& p, int plies, std::vector<position>& positions )
+{
+	if( !plies ) {
+		positions.push_back( p );
+		return;
+	}
+
+	check_map check( p );
+	std::vector<move> moves = calculate_moves<movegen_type::all>( p, check );
+	for( auto const& m : moves ) {
+		position new_pos( p );
+		apply_move( new_pos, m );
+		collect_positions( new_pos, plies - 1, positions );
+	}
+}
+}
+
+uint64_t parallel_perft( config const& conf, position const& p, int depth )
+{
+	if( depth < 1 ) {
+		return 1;
+	}
+
+	unsigned int const thread_count = conf.thread_count ? conf.thread_count : 1;
+	perft_hash hash( conf.perft_hash, thread_count );
+
+	// The last ply is counted in bulk, it cannot be split.
+	int const split_plies = std::min( 2, depth - 1 );
+	std::vector<position> positions;
+	collect_positions( p, split_plies, positions );
+
+	std::vector<uint64_t> counts( positions.size() );
+	atomic_uint64_t next;
+	atomic_store( next, 0 );
+
+	parallel_for( thread_count, thread_count, [&]( uint64_t, uint64_t ) {
+		std::vector<move_info> moves( max_moves_per_ply * depth );
+		uint64_t i;
+		while( (i = add_fetch( next, 1 ) - 1) < positions.size() ) {
+			position pos = positions[i];
+			counts[i] = perft( hash, &moves[0], depth - split_plies, pos );
+		}
+	} );
+
+	uint64_t n = 0;
+	for( auto c : counts ) {
+		n += c;
+	}
+	return n;
+}
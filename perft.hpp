@@ -0,0 +1,21 @@
+#ifndef __PERFT_H__
+#define __PERFT_H__
+
+#include "config.hpp"
+#include "position.hpp"
+
+/*
+ * Counts the leaf nodes of the tree of legal moves to the given depth.
+ *
+ * The positions after the first two plies get distributed over
+ * conf.thread_count threads, each thread picking the next position once it
+ * is done with the previous one.
+ *
+ * If conf.perft_hash is set, the counts of subtrees are stored in a hash
+ * table of that many megabytes, shared by all threads. It is lockless,
+ * each entry is two words and the key word gets xored with the data word.
+ * Entries torn by concurrent writes are thus ignored.
+ */
+uint64_t parallel_perft( config const& conf, position const& p, int depth );
+
+#endif
@@ -36,6 +36,36 @@ phased_move_generator_base::~phased_move_generator_base()
 }
 
 
+bool phased_move_generator_base::validate_hash_move()
+{
+#if !CHECK_TYPE_1_COLLISION && USE_STATISTICS < 2
+	// With full keys, collisions are too rare to be worth the check.
+	if( !state_.tt_->partial_keys() ) {
+		return true;
+	}
+#endif
+
+	if( is_valid_move( p_, hash_move, check_ ) ) {
+		return true;
+	}
+
+#if USE_STATISTICS >= 2
+	state_.tt_->add_type1_collision();
+#endif
+#if CHECK_TYPE_1_COLLISION
+	std::cerr << "Possible type-1 hash collision:" << std::endl;
+	std::cerr << board_to_string( p_, color::white ) << std::endl;
+	config tmp;
+	tmp.fischer_random = true;
+	std::cerr << position_to_fen_noclock( tmp, p_ ) << std::endl;
+	std::cerr << move_to_string( p_, hash_move ) << std::endl;
+#endif
+
+	hash_move.clear();
+	return false;
+}
+
+
 qsearch_move_generator::qsearch_move_generator( calc_state& cntx, position const& p, check_map const& check, bool pv_node, bool include_noncaptures )
 	: phased_move_generator_base( cntx, p, check )
 	, pv_node_( pv_node )
@@ -64,21 +94,8 @@ move qsearch_move_generator::next()
 	switch( phase ) {
 	case phases::hash_move:
 		phase = phases::captures_gen;
-		if( !hash_move.empty() ) {
-#if CHECK_TYPE_1_COLLISION
-			if( !is_valid_move( p_, hash_move, check_ ) ) {
-				std::cerr << "Possible type-1 hash collision:" << std::endl;
-				std::cerr << board_to_string( p_, color::white ) << std::endl;
-				config tmp;
-				tmp.fischer_random = true;
-				std::cerr << position_to_fen_noclock( tmp, p_ ) << std::endl;
-				std::cerr << move_to_string( p_, hash_move ) << std::endl;
-			}
-			else
-#endif
-			{
-				return hash_move;
-			}
+		if( !hash_move.empty() && validate_hash_move() ) {
+			return hash_move;
 		}
 	case phases::captures_gen:
 		calculate_moves<movegen_type::capture>( p_, state_.move_ptr, check_ );
@@ -194,21 +211,8 @@ move move_generator::next()
 	switch( phase ) {
 	case phases::hash_move:
 		phase = phases::captures_gen;
-		if( !hash_move.empty() ) {
-#if CHECK_TYPE_1_COLLISION
-			if( !is_valid_move( p_, hash_move, check_ ) ) {
-				std::cerr << "Possible type-1 hash collision:" << std::endl;
-				std::cerr << board_to_string( p_, color::white ) << std::endl;
-				config tmp;
-				tmp.fischer_random = true;
-				std::cerr << position_to_fen_noclock( tmp, p_ ) << std::endl;
-				std::cerr << move_to_string( p_, hash_move ) << std::endl;
-			}
-			else
-#endif
-			{
-				return hash_move;
-			}
+		if( !hash_move.empty() && validate_hash_move() ) {
+			return hash_move;
 		}
 	case phases::captures_gen:
 		calculate_moves<movegen_type::capture>( p_, state_.move_ptr, check_ );
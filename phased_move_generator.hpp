@@ -44,6 +44,10 @@ public:
 	move hash_move;
 
 protected:
+	// Returns false and clears the hash move if it is not legal in the
+	// position, as happens on type-1 collisions.
+	bool validate_hash_move();
+
 	calc_state& state_;
 	phases::type phase;
 	move_info* const moves;
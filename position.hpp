@@ -35,13 +35,6 @@ class position
 public:
 	position();
 
-	// At most two bits are set, each bit indicates the file of the rook that can castle.
-	unsigned char castle[2];
-
-	// 0 if en-passant not possible.
-	// Otherwise the enpassant square.
-	unsigned char can_en_passant;
-
 	// After setting bitboards, castling rights and en-passant square,
 	// call this function to update all derived values, e.g. material or
 	// the pawn hash.
@@ -49,27 +42,14 @@ public:
 
 	void clear_bitboards();
 
-	uint64_t pawn_hash;
-
-	score material[2];
-
 	inline color::type self() const { return c; }
 	inline color::type other() const { return ::other(c); }
 	inline bool white() const { return c == color::white; }
 	inline bool black() const { return c == color::black; }
 
-	// Material and pst, nothing else.
-	score base_eval;
-
-	bitboard bitboards[2][bb_type::value_max];
-
-	square::type king_pos[2];
-
 	bool is_occupied_square( uint64_t square ) const;
 	uint64_t get_occupancy( uint64_t mask = 0xffffffffffffffffull ) const;
 
-	color::type c;
-
 	// Resets position to initial starting position
 	void reset();
 
@@ -90,18 +70,46 @@ public:
 	pieces_with_color::type get_piece_with_color( move const& m ) const;
 	pieces_with_color::type get_captured_piece_with_color( move const& m ) const;
 
-	pieces_with_color::type board[64];
+	uint64_t init_hash() const;
+	void init_material();
+	void init_eval();
+
+	/*
+	 * The data members are ordered by access pattern: First the scalar state
+	 * every node needs, e.g. for the hash table lookups and the lazy
+	 * evaluation, all within the first 56 bytes. Then the bitboards, then
+	 * the board.
+	 */
+
+	uint64_t hash_;
+
+	uint64_t pawn_hash;
 
 	// Used as key to switch between endgame evaluations
 	uint64_t piece_sum;
 
+	score material[2];
+
+	// Material and pst, nothing else.
+	score base_eval;
+
 	unsigned int halfmoves_since_pawnmove_or_capture;
 
-	uint64_t hash_;
+	square::type king_pos[2];
+
+	color::type c;
+
+	// At most two bits are set, each bit indicates the file of the rook that can castle.
+	unsigned char castle[2];
+
+	// 0 if en-passant not possible.
+	// Otherwise the enpassant square.
+	unsigned char can_en_passant;
+
+	bitboard bitboards[2][bb_type::value_max];
+
+	pieces_with_color::type board[64];
 
-	uint64_t init_hash() const;
-	void init_material();
-	void init_eval();
 private:
 	void init_bitboards();
 	void init_board();
@@ -109,4 +117,12 @@ private:
 	void init_piece_sum();
 };
 
+// Intended layout: The three 64 bit hash words and the hot scalar state take
+// the first 52 bytes, 4 bytes of padding align the bitboards to 8 bytes at
+// offset 56. 128 bytes of bitboards and the 64 byte board follow, 248 bytes
+// in total without tail padding. position is not aligned to a cache line,
+// so a copy can still span five of them, but it must never take more than
+// four lines worth of data.
+static_assert( sizeof(position) <= 256, "position exceeds four cache lines, check the member layout" );
+
 #endif
@@ -5,60 +5,137 @@
  * The score object represents evaluation scores. It can be used for partial evaluations
  * as well as complete positional evaluations.
  *
- * The score is being represented by two shorts, one for middle-game and one for end-game
+ * The score consists of two shorts, one for middle-game and one for end-game
  * evaluation. This distinction is necessary as the evaluation terms are a lot different
  * between game phases.
  *
  * For the search it becomes necessary to extract a single value from the composite score.
  * This value is scaled between the middle-game and end-game score based on the material
  * still on the board.
+ *
+ * Both values are packed into a single 32bit integer, mg + eg * 65536, so that
+ * adding, subtracting, negating and multiplying with a scalar are a single
+ * integer operation each. A negative middle-game value borrows from the
+ * end-game half, which the eg() accessor rounds back out. Arithmetic is done
+ * unsigned, as intermediate results may wrap around.
  */
 
+#include "assert.hpp"
+
 #include <ostream>
+#include <stdint.h>
 
 class score
 {
 public:
 	typedef short value_type;
 
-	score();
-	score( value_type mg, value_type eg );
-	score( score const& rhs );
-
-	short scale( value_type material ) const;
-
-	score operator+( score const& rhs ) const;
-	score operator-( score const& rhs ) const;
-
-	score operator-() const;
-
-	score& operator+=( score const& rhs );
-	score& operator-=( score const& rhs );
+	score()
+		: v_()
+	{
+	}
 
-	score& operator=( score const& rhs );
+	score( value_type mg, value_type eg )
+		: v_( pack( mg, eg ) )
+	{
+	}
 
-	value_type mg() const { return mg_; }
-	value_type eg() const { return eg_; }
-
-	value_type& mg() { return mg_; }
-	value_type& eg() { return eg_; }
-
-	typedef value_type&(score::*phase_ref)();
-
-	bool operator==( score const& rhs ) const;
-	bool operator!=( score const& rhs ) const;
+	short scale( value_type material ) const;
 
-	score operator*( value_type m ) const;
-	score operator*( score const& m ) const;
+	score operator+( score const& rhs ) const {
+		score ret = *this;
+		ret += rhs;
+		return ret;
+	}
+
+	score operator-( score const& rhs ) const {
+		score ret = *this;
+		ret -= rhs;
+		return ret;
+	}
+
+	score operator-() const {
+		return from_packed( 0u - v_ );
+	}
+
+	score& operator+=( score const& rhs ) {
+		ASSERT( static_cast<int>(mg()) + rhs.mg() < 32768 );
+		ASSERT( static_cast<int>(mg()) + rhs.mg() >= -32768 );
+		ASSERT( static_cast<int>(eg()) + rhs.eg() < 32768 );
+		ASSERT( static_cast<int>(eg()) + rhs.eg() >= -32768 );
+
+		v_ += rhs.v_;
+		return *this;
+	}
+
+	score& operator-=( score const& rhs ) {
+		ASSERT( static_cast<int>(mg()) - rhs.mg() < 32768 );
+		ASSERT( static_cast<int>(mg()) - rhs.mg() >= -32768 );
+		ASSERT( static_cast<int>(eg()) - rhs.eg() < 32768 );
+		ASSERT( static_cast<int>(eg()) - rhs.eg() >= -32768 );
+
+		v_ -= rhs.v_;
+		return *this;
+	}
+
+	value_type mg() const { return static_cast<value_type>(static_cast<unsigned short>(v_)); }
+	value_type eg() const { return static_cast<value_type>(static_cast<unsigned short>((v_ + 0x8000u) >> 16)); }
+
+	void set_mg( value_type mg ) { v_ = pack( mg, eg() ); }
+	void set_eg( value_type eg ) { v_ = pack( mg(), eg ); }
+
+	typedef value_type (score::*phase_getter)() const;
+	typedef void (score::*phase_setter)( value_type );
+
+	bool operator==( score const& rhs ) const { return v_ == rhs.v_; }
+	bool operator!=( score const& rhs ) const { return v_ != rhs.v_; }
+
+	score operator*( value_type m ) const {
+		ASSERT( static_cast<int>(mg()) * m < 32768 );
+		ASSERT( static_cast<int>(mg()) * m >= -32768 );
+		ASSERT( static_cast<int>(eg()) * m < 32768 );
+		ASSERT( static_cast<int>(eg()) * m >= -32768 );
+
+		return from_packed( v_ * static_cast<uint32_t>(static_cast<int>(m)) );
+	}
+
+	score operator*( score const& m ) const {
+		ASSERT( static_cast<int>(mg()) * m.mg() < 32768 );
+		ASSERT( static_cast<int>(mg()) * m.mg() >= -32768 );
+		ASSERT( static_cast<int>(eg()) * m.eg() < 32768 );
+		ASSERT( static_cast<int>(eg()) * m.eg() >= -32768 );
+
+		return score( mg() * m.mg(), eg() * m.eg() );
+	}
+
+	score& operator*=( value_type m ) {
+		*this = *this * m;
+		return *this;
+	}
+
+	score operator/( value_type m ) const {
+		ASSERT( m != 0 );
+		return score( mg() / m, eg() / m );
+	}
+
+	score operator/( score const& m ) const {
+		ASSERT( m.mg() != 0 );
+		ASSERT( m.eg() != 0 );
+		return score( mg() / m.mg(), eg() / m.eg() );
+	}
 
-	score& operator*=( value_type m );
+private:
+	static uint32_t pack( value_type mg, value_type eg ) {
+		return (static_cast<uint32_t>(static_cast<unsigned short>(eg)) << 16) + static_cast<uint32_t>(static_cast<int>(mg));
+	}
 
-	score operator/( value_type m ) const;
-	score operator/( score const& m ) const;
+	static score from_packed( uint32_t v ) {
+		score ret;
+		ret.v_ = v;
+		return ret;
+	}
 
-private:
-	value_type mg_;
-	value_type eg_;
+	uint32_t v_;
 };
 
 std::ostream& operator<<(std::ostream&, score const&);
@@ -3,13 +3,19 @@
 #include "config.hpp"
 #include "endgame.hpp"
 #include "eval.hpp"
+#include "eval_cache.hpp"
 #include "eval_values.hpp"
 #include "fen.hpp"
+#include "magic.hpp"
+#include "material_table.hpp"
 #include "moves.hpp"
+#include "nnue.hpp"
 #include "pawn_structure_hash_table.hpp"
+#include "perft.hpp"
 #include "random.hpp"
 #include "see.hpp"
 #include "selftest.hpp"
+#include "sliding_piece_attacks.hpp"
 #include "util/logger.hpp"
 #include "util/mutex.hpp"
 #include "util/time.hpp"
@@ -86,6 +92,50 @@ void perft( perft_ctx& ctx, int depth, position const& p, uint64_t& n )
 	ctx.move_ptr = moves;
 }
 
+// Same as above, but with make/unmake instead of copying the position
+void perft_make_unmake( perft_ctx& ctx, int depth, position& p, uint64_t& n )
+{
+	move_info* moves = ctx.move_ptr;
+
+	check_map check( p );
+	calculate_moves<movegen_type::all>( p, ctx.move_ptr, check );
+
+	if( !--depth ) {
+		n += ctx.move_ptr - moves;
+		ctx.move_ptr = moves;
+		return;
+	}
+
+	for( move_info* it = moves; it != ctx.move_ptr; ++it ) {
+		move_undo undo;
+		apply_move( p, it->m, undo );
+		perft_make_unmake( ctx, depth, p, n );
+		undo_move( p, it->m, undo );
+	}
+	ctx.move_ptr = moves;
+}
+
+namespace {
+void print_perft_stats( uint64_t moves, duration const& elapsed )
+{
+	std::cerr << "Took:      "     << elapsed.milliseconds() << " ms" << std::endl;
+	if( moves ) {
+		// Will overflow after ~3 months
+		int64_t picoseconds = elapsed.picoseconds();
+		picoseconds /= moves;
+
+		std::stringstream ss;
+		ss << "Time/move: " << picoseconds / 1000 << "." << std::setw(1) << std::setfill('0') << (picoseconds / 100) % 10 << " ns" << std::endl;
+
+		if( !elapsed.empty() ) {
+			ss << "Moves/s:   " << elapsed.get_items_per_second(moves) << std::endl;
+		}
+
+		std::cerr << ss.str();
+	}
+}
+}
+
 template<bool split_movegen>
 void perft( position const& p, std::vector<uint64_t> const& expected, std::size_t max_depth = 0, bool verbose = true )
 {
@@ -119,21 +169,7 @@ void perft( position const& p, std::vector<uint64_t> const& expected, std::size_
 			}
 
 			std::cerr << std::endl;
-			std::cerr << "Took:      "     << elapsed.milliseconds() << " ms" << std::endl;
-			if( ret ) {
-				// Will overflow after ~3 months
-				int64_t picoseconds = elapsed.picoseconds();
-				picoseconds /= ret;
-
-				std::stringstream ss;
-				ss << "Time/move: " << picoseconds / 1000 << "." << std::setw(1) << std::setfill('0') << (picoseconds / 100) % 10 << " ns" << std::endl;
-
-				if( !elapsed.empty() ) {
-					ss << "Moves/s:   " << elapsed.get_items_per_second(ret) << std::endl;
-				}
-
-				std::cerr << ss.str();
-			}
+			print_perft_stats( ret, elapsed );
 		}
 
 		if( i < expected.size() && expected[i] != 0 && ret != expected[i] ) {
@@ -147,9 +183,357 @@ void perft( position const& p, std::vector<uint64_t> const& expected, std::size_
 	}
 }
 
-void perft( position const& p )
+void perft( config const& conf, position const& p )
+{
+	for( int depth = 1; ; ++depth ) {
+		std::cerr << "Calculating number of possible moves in " << depth << " plies:" << std::endl;
+
+		timestamp start;
+		uint64_t moves = parallel_perft( conf, p, depth );
+		duration elapsed = timestamp() - start;
+
+		std::cerr << "Moves:     " << moves << std::endl;
+		print_perft_stats( moves, elapsed );
+		std::cerr << std::endl;
+	}
+}
+
+
+void perft_compare( position const& p, int depth )
+{
+	if( depth < 1 ) {
+		depth = 1;
+	}
+
+	perft_ctx ctx;
+
+	uint64_t copy_nodes = 0;
+	timestamp start;
+	perft<false>( ctx, depth, p, copy_nodes );
+	duration copy_time = timestamp() - start;
+
+	position p2 = p;
+	uint64_t make_nodes = 0;
+	start = timestamp();
+	perft_make_unmake( ctx, depth, p2, make_nodes );
+	duration make_time = timestamp() - start;
+
+	std::stringstream ss;
+	ss << "Perft " << depth << ": " << copy_nodes << " moves" << std::endl;
+	ss << "Copy-make:   " << std::setw(6) << copy_time.milliseconds() << " ms";
+	if( !copy_time.empty() ) {
+		ss << ", " << copy_time.get_items_per_second( copy_nodes ) << " moves/s";
+	}
+	ss << std::endl;
+	ss << "Make/unmake: " << std::setw(6) << make_time.milliseconds() << " ms";
+	if( !make_time.empty() ) {
+		ss << ", " << make_time.get_items_per_second( make_nodes ) << " moves/s";
+	}
+	ss << std::endl;
+	if( make_nodes != copy_nodes ) {
+		ss << "Mismatch, make/unmake counted " << make_nodes << " moves" << std::endl;
+	}
+	std::cerr << ss.str();
+}
+
+void slider_benchmark()
+{
+	// Occupancies of about a quarter of the board, from sparse to crowded
+	std::vector<std::pair<uint64_t, uint64_t>> samples;
+	randgen rng( 1 );
+	for( int i = 0; i < 4096; ++i ) {
+		uint64_t occ = rng.get_uint64() & rng.get_uint64();
+		if( i % 2 ) {
+			occ &= rng.get_uint64();
+		}
+		samples.push_back( std::make_pair( rng.get_uint64() % 64, occ ) );
+	}
+
+	position start;
+	start.reset();
+
+	slider_lookup::type const old = get_slider_lookup();
+
+	int const rounds = 10000;
+	int const depth = 6;
+
+	uint64_t reference = 0;
+	bool first = true;
+	for( int t = slider_lookup::magic; t <= slider_lookup::pext; ++t ) {
+		slider_lookup::type const type = static_cast<slider_lookup::type>(t);
+		if( !set_slider_lookup( type ) ) {
+			continue;
+		}
+
+		uint64_t sum = 0;
+		timestamp begin;
+		for( int r = 0; r < rounds; ++r ) {
+			for( auto const& s : samples ) {
+				sum += rook_magic( s.first, s.second ) ^ bishop_magic( s.first, s.second );
+			}
+		}
+		duration lookup_time = timestamp() - begin;
+
+		perft_ctx ctx;
+		uint64_t nodes = 0;
+		begin = timestamp();
+		perft<false>( ctx, depth, start, nodes );
+		duration perft_time = timestamp() - begin;
+
+		std::stringstream ss;
+		ss << std::left << std::setw(6) << slider_lookup_name( type ) << std::right
+		   << std::setw(6) << lookup_time.milliseconds() << " ms";
+		if( !lookup_time.empty() ) {
+			ss << ", " << std::setw(10) << lookup_time.get_items_per_second( uint64_t(rounds) * samples.size() * 2 ) << " lookups/s";
+		}
+		ss << ", perft " << depth << " " << std::setw(6) << perft_time.milliseconds() << " ms";
+		if( !perft_time.empty() ) {
+			ss << ", " << std::setw(9) << perft_time.get_items_per_second( nodes ) << " moves/s";
+		}
+		if( type == old ) {
+			ss << " (default)";
+		}
+		ss << std::endl;
+		std::cerr << ss.str();
+
+		if( first ) {
+			reference = sum;
+			first = false;
+		}
+		else if( sum != reference ) {
+			std::cerr << "Mismatch, " << slider_lookup_name( type ) << " lookups differ from magic ones" << std::endl;
+		}
+	}
+
+	set_slider_lookup( old );
+}
+
+namespace {
+struct handcrafted_evaluator {
+	handcrafted_evaluator( pawn_structure_hash_table& pawn_tt )
+		: pawn_tt_(pawn_tt)
+	{
+	}
+
+	void reset( position const& ) {}
+	void push( position const&, move const& ) {}
+	void pop() {}
+	short evaluate( position const& p ) { return evaluate_full( pawn_tt_, p ); }
+
+	pawn_structure_hash_table& pawn_tt_;
+};
+
+struct nnue_refresh_evaluator {
+	void reset( position const& ) {}
+	void push( position const&, move const& ) {}
+	void pop() {}
+	short evaluate( position const& p ) { return nnue::evaluate( p ); }
+};
+
+struct nnue_incremental_evaluator {
+	nnue_incremental_evaluator( nnue::accumulator_stack& stack )
+		: stack_(stack)
+	{
+	}
+
+	void reset( position const& p ) { stack_.reset( p ); }
+	void push( position const& p, move const& m ) { stack_.push( p, m ); }
+	void pop() { stack_.pop(); }
+	short evaluate( position const& p ) { return stack_.evaluate( p ); }
+
+	nnue::accumulator_stack& stack_;
+};
+
+// Evaluates all children of the given positions, like the search does.
+template<typename Evaluator>
+int64_t time_evaluation( std::string const& name, Evaluator& e, std::vector<position> const& roots, std::vector<std::vector<move>> const& moves, int rounds )
+{
+	uint64_t count = 0;
+	int64_t sum = 0;
+
+	timestamp start;
+	for( int r = 0; r < rounds; ++r ) {
+		for( std::size_t i = 0; i < roots.size(); ++i ) {
+			position p = roots[i];
+			e.reset( p );
+			for( auto const& m : moves[i] ) {
+				move_undo undo;
+				e.push( p, m );
+				apply_move( p, m, undo );
+				sum += e.evaluate( p );
+				undo_move( p, m, undo );
+				e.pop();
+				++count;
+			}
+		}
+	}
+	duration elapsed = timestamp() - start;
+
+	std::stringstream ss;
+	ss << std::left << std::setw(26) << name << std::right << std::setw(6) << elapsed.milliseconds() << " ms";
+	if( !elapsed.empty() ) {
+		ss << ", " << std::setw(9) << elapsed.get_items_per_second( count ) << " evals/s";
+	}
+	ss << std::endl;
+	std::cerr << ss.str();
+
+	return sum;
+}
+}
+
+
+void eval_benchmark( context& ctx )
+{
+	std::vector<position> roots;
+	std::vector<std::vector<move>> moves;
+
+	std::ifstream in_fen( ctx.conf_.self_dir + "test/testpositions.txt" );
+	std::string fen;
+	while( roots.size() < 2000 && std::getline( in_fen, fen ) ) {
+		position p;
+		if( parse_fen( ctx.conf_, fen, p ) ) {
+			check_map check( p );
+			roots.push_back( p );
+			moves.push_back( calculate_moves<movegen_type::all>( p, check ) );
+		}
+	}
+	if( roots.empty() ) {
+		std::cerr << "Could not read test positions" << std::endl;
+		return;
+	}
+
+	bool const was_enabled = nnue::enabled();
+	nnue::simd::type const old_simd = nnue::get_simd();
+	if( !nnue::set_enabled( true ) ) {
+		// Only speed is measured, the weights do not matter.
+		std::cerr << "No network loaded, using random weights" << std::endl;
+		nnue::randomize( 1 );
+	}
+
+	int const rounds = 5;
+
+	ctx.pawn_tt_.init( ctx.conf_ );
+	nnue::set_enabled( false );
+	handcrafted_evaluator handcrafted( ctx.pawn_tt_ );
+	time_evaluation( "Hand-crafted", handcrafted, roots, moves, rounds );
+
+	nnue::set_enabled( true );
+	std::unique_ptr<nnue::accumulator_stack> stack( new nnue::accumulator_stack );
+
+	int64_t reference = 0;
+	bool first = true;
+	for( int t = nnue::simd::scalar; t <= nnue::simd::avx2; ++t ) {
+		if( !nnue::set_simd( static_cast<nnue::simd::type>(t) ) ) {
+			continue;
+		}
+		std::string simd = nnue::simd_name( static_cast<nnue::simd::type>(t) );
+
+		nnue_refresh_evaluator refresh;
+		int64_t sum = time_evaluation( "NNUE refresh (" + simd + ")", refresh, roots, moves, rounds );
+
+		nnue_incremental_evaluator incremental( *stack );
+		int64_t incremental_sum = time_evaluation( "NNUE incremental (" + simd + ")", incremental, roots, moves, rounds );
+
+		if( first ) {
+			reference = sum;
+			first = false;
+		}
+		if( sum != reference || incremental_sum != reference ) {
+			std::cerr << "Mismatch, " << simd << " evaluations differ from scalar ones" << std::endl;
+		}
+	}
+
+	nnue::set_simd( old_simd );
+	nnue::set_enabled( was_enabled );
+}
+
+void bench( context& ctx )
 {
-	perft<false>( p, {}, 999999, true );
+	// Fixed defaults, so that the node count is comparable across machines
+	config conf = ctx.conf_;
+	if( !conf.thread_count_given ) {
+		conf.thread_count = 1;
+	}
+	if( !conf.memory_given ) {
+		conf.memory = 16;
+	}
+	int const depth = (conf.max_search_depth() != MAX_DEPTH) ? conf.max_search_depth() : 11;
+
+	// Every 500th position of the test set
+	std::vector<std::string> fens;
+	std::ifstream in_fen( conf.self_dir + "test/testpositions.txt" );
+	std::string line;
+	for( std::size_t i = 0; std::getline( in_fen, line ); ++i ) {
+		if( !(i % 500) ) {
+			fens.push_back( line );
+		}
+	}
+	if( fens.empty() ) {
+		std::cerr << "Could not read test positions" << std::endl;
+		return;
+	}
+
+	bool const debug = logger::show_debug();
+	logger::show_debug( false );
+
+	std::cout << "Searching " << fens.size() << " positions to depth " << depth << " with " << conf.thread_count << " thread(s) and " << conf.memory << " MB hash" << std::endl;
+	if( conf.thread_count > 1 ) {
+		std::cout << "Node counts of searches with several threads vary from run to run" << std::endl;
+	}
+	std::cout << std::endl;
+	std::cout << "  #      Time         Nodes    Nodes/s  Best move" << std::endl;
+
+	uint64_t total_nodes = 0;
+	duration total_elapsed;
+	for( std::size_t i = 0; i < fens.size(); ++i ) {
+		// A fresh context for each position, no results carry over
+		context bench_ctx;
+		bench_ctx.conf_ = conf;
+		bench_ctx.tt_.init( bench_ctx.conf_ );
+		bench_ctx.pawn_tt_.init( bench_ctx.conf_ );
+
+		position p;
+		std::string error;
+		if( !parse_fen( bench_ctx.conf_, fens[i], p, &error ) ) {
+			std::cerr << "Could not parse fen: " << error << std::endl;
+			std::cerr << "Fen: " << fens[i] << std::endl;
+			continue;
+		}
+
+		calc_manager cmgr( bench_ctx );
+		seen_positions seen( p.hash_ );
+
+		timestamp start;
+		calc_result result = cmgr.calc( p, depth, start, duration::infinity(), duration::infinity(), 0, seen, null_new_best_move_cb );
+		duration elapsed = timestamp() - start;
+
+		uint64_t nodes = 0;
+#if USE_STATISTICS
+		statistics& s = cmgr.stats();
+		nodes = s.total_full_width_nodes + s.total_quiescence_nodes;
+#endif
+		total_nodes += nodes;
+		total_elapsed += elapsed;
+
+		std::stringstream ss;
+		ss << std::setw(3) << (i + 1) << std::setw(8) << elapsed.milliseconds() << " ms" << std::setw(12) << nodes;
+		ss << std::setw(11) << (elapsed.empty() ? 0 : elapsed.get_items_per_second( nodes ));
+		ss << "  " << move_to_string( p, result.best_move ) << std::endl;
+		std::cout << ss.str();
+	}
+
+	logger::show_debug( debug );
+
+	std::cout << std::endl;
+	std::cout << "Total time: " << total_elapsed.milliseconds() << " ms" << std::endl;
+#if USE_STATISTICS
+	std::cout << "Nodes:      " << total_nodes << std::endl;
+	if( !total_elapsed.empty() ) {
+		std::cout << "Nodes/s:    " << total_elapsed.get_items_per_second( total_nodes ) << std::endl;
+	}
+#else
+	std::cout << "Nodes:      not counted, needs a build with USE_STATISTICS" << std::endl;
+#endif
 }
 
 namespace {
@@ -653,6 +1037,28 @@ static void process_test_positions( context& ctx )
 	}
 }
 
+static bool same_position( position const& a, position const& b )
+{
+	for( int c = 0; c < 2; ++c ) {
+		for( int i = 0; i < bb_type::value_max; ++i ) {
+			if( a.bitboards[c][i] != b.bitboards[c][i] ) {
+				return false;
+			}
+		}
+		if( a.castle[c] != b.castle[c] || a.material[c] != b.material[c] || a.king_pos[c] != b.king_pos[c] ) {
+			return false;
+		}
+	}
+	for( int sq = 0; sq < 64; ++sq ) {
+		if( a.board[sq] != b.board[sq] ) {
+			return false;
+		}
+	}
+	return a.c == b.c && a.can_en_passant == b.can_en_passant && a.hash_ == b.hash_ && a.pawn_hash == b.pawn_hash &&
+		a.base_eval == b.base_eval && a.piece_sum == b.piece_sum &&
+		a.halfmoves_since_pawnmove_or_capture == b.halfmoves_since_pawnmove_or_capture;
+}
+
 static void test_perft( context& ctx, std::string const& fen, std::vector<uint64_t> expected )
 {
 	position p = test_parse_fen( ctx, fen );
@@ -661,6 +1067,23 @@ static void test_perft( context& ctx, std::string const& fen, std::vector<uint64
 	std::cerr << ".";
 	perft<false>(p, expected, 0, false);
 	std::cerr << ".";
+
+	// Make/unmake needs to count the same and leave the position unchanged
+	position p2 = p;
+	perft_ctx pctx;
+	for( std::size_t depth = 1; depth <= expected.size(); ++depth ) {
+		uint64_t n = 0;
+		perft_make_unmake( pctx, static_cast<int>(depth), p2, n );
+		if( expected[depth - 1] && n != expected[depth - 1] ) {
+			std::cerr << "FAIL! Make/unmake perft " << depth << " of " << fen << " got " << n << " moves, expected " << expected[depth - 1] << std::endl;
+			abort();
+		}
+	}
+	if( !same_position( p, p2 ) ) {
+		std::cerr << "FAIL! Make/unmake perft did not restore position " << fen << std::endl;
+		abort();
+	}
+	std::cerr << ".";
 }
 
 typedef std::pair<std::string,std::vector<uint64_t>> perft_data_entry_t;
@@ -702,6 +1125,32 @@ public:
 	mutex& m_;
 };
 
+static void test_parallel_perft( context& ctx )
+{
+	checking( "parallel perft" );
+
+	position start;
+	start.reset();
+	position kiwipete = test_parse_fen( ctx, "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -" );
+
+	// More threads than processors is fine, the results need to be the same
+	config conf = ctx.conf_;
+	conf.thread_count = 4;
+	for( unsigned int hash = 0; hash <= 16; hash += 16 ) {
+		conf.perft_hash = hash;
+		if( parallel_perft( conf, start, 1 ) != 20 ||
+			parallel_perft( conf, start, 2 ) != 400 ||
+			parallel_perft( conf, start, 5 ) != 4865609 ||
+			parallel_perft( conf, kiwipete, 4 ) != 4085603 )
+		{
+			std::cerr << "Parallel perft failed, hash size " << hash << std::endl;
+			abort();
+		}
+	}
+
+	pass();
+}
+
 static void test_perft( context& ctx )
 {
 	checking( "perft" );
@@ -808,6 +1257,35 @@ static void check_bitscan()
 	pass();
 }
 
+static void check_slider_lookup()
+{
+	checking("slider lookup");
+
+	uint64_t rays[8][64];
+	init_rays( rays );
+
+	slider_lookup::type const old = get_slider_lookup();
+
+	randgen rng( 42 );
+	for( int t = slider_lookup::magic; t <= slider_lookup::pext; ++t ) {
+		if( !set_slider_lookup( static_cast<slider_lookup::type>(t) ) ) {
+			continue;
+		}
+		for( uint64_t pi = 0; pi < 64; ++pi ) {
+			for( int i = 0; i < 1000; ++i ) {
+				uint64_t occ = rng.get_uint64() & rng.get_uint64();
+				if( rook_magic( pi, occ ) != rook_attacks( pi, occ, rays ) || bishop_magic( pi, occ ) != bishop_attacks( pi, occ, rays ) ) {
+					std::cerr << "Wrong " << slider_lookup_name( static_cast<slider_lookup::type>(t) ) << " slider attacks on square " << pi << " with occupancy " << occ << std::endl;
+					abort();
+				}
+			}
+		}
+	}
+
+	set_slider_lookup( old );
+	pass();
+}
+
 static void check_see( context& ctx, std::string const& fen, std::string const& ms, int expected )
 {
 	position p = test_parse_fen( ctx, fen );
@@ -1024,6 +1502,55 @@ void check_endgame_eval( context& ctx )
 	pass();
 }
 
+
+static bool same_material_entry( material_entry const& a, material_entry const& b )
+{
+	return a.imbalance == b.imbalance && a.endgame == b.endgame &&
+		a.scale[0] == b.scale[0] && a.scale[1] == b.scale[1] &&
+		a.opposite_bishops == b.opposite_bishops;
+}
+
+
+void check_material_table( context& ctx )
+{
+	checking("material table");
+
+	material_table::clear();
+
+	std::string const fens[] = {
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+		"r1b1k2r/ppp2ppp/2n5/8/8/2N5/PPP2PPP/R3KB1R w KQkq - 0 1",
+		"4k3/8/8/8/8/8/8/3NKB2 w - - 0 1",
+		"4k3/8/8/3b4/8/8/2PB4/4K3 w - - 0 1",
+		"4k3/8/8/8/8/8/8/2B1KB2 w - - 0 1",
+		"4k3/3p4/8/8/8/8/3P4/4K3 w - - 0 1",
+		"2r1k3/8/8/8/8/8/8/1NB1K3 w - - 0 1",
+		"4k3/8/8/8/8/8/8/3RK3 w - - 0 1"
+	};
+
+	for( std::size_t i = 0; i < sizeof(fens) / sizeof(fens[0]); ++i ) {
+		for( int flip = 0; flip < 2; ++flip ) {
+			position p = test_parse_fen( ctx, flip ? flip_fen( fens[i] ) : fens[i] );
+
+			material_entry const computed = material_table::compute( p.piece_sum );
+			if( computed.endgame != get_endgame_function( p.piece_sum ) ) {
+				std::cerr << "Material table entry has wrong endgame function: " << fens[i] << std::endl;
+				abort();
+			}
+
+			// First probe fills the table, the second one reads it back.
+			for( int j = 0; j < 2; ++j ) {
+				if( !same_material_entry( material_table::probe( p.piece_sum ), computed ) ) {
+					std::cerr << "Material table entry does not match computed one: " << fens[i] << std::endl;
+					abort();
+				}
+			}
+		}
+	}
+
+	pass();
+}
+
 void check_time()
 {
 	checking("time classes");
@@ -1157,6 +1684,266 @@ void test_context_isolation()
 	pass();
 }
 
+void test_smp( smp_mode::type mode, bool numa = false, bool per_thread_pawn_hash = false )
+{
+	context ctx;
+	ctx.conf_.thread_count = 4;
+	ctx.conf_.smp = mode;
+	ctx.conf_.numa = numa;
+	ctx.conf_.per_thread_pawn_hash = per_thread_pawn_hash;
+	ctx.conf_.memory = 1;
+	ctx.tt_.init( ctx.conf_ );
+	ctx.pawn_tt_.init( 1 );
+
+	calc_manager c(ctx);
+
+	position p;
+	seen_positions seen;
+
+	calc_result result = c.calc( p, 9, timestamp(), duration::infinity(), duration::infinity(), 0, seen, null_new_best_move_cb );
+	if( result.best_move.empty() || !validate_move( p, result.best_move ) ) {
+		std::cerr << "Multithreaded search did not return a valid move" << std::endl;
+		abort();
+	}
+}
+
+void test_smp()
+{
+	checking("multithreaded search");
+
+	bool debug = logger::show_debug();
+	logger::show_debug( false );
+
+	test_smp( smp_mode::ybwc );
+	test_smp( smp_mode::lazy );
+	test_smp( smp_mode::ybwc, true );
+	test_smp( smp_mode::lazy, false, true );
+
+	logger::show_debug( debug );
+
+	pass();
+}
+
+void test_parallel_clear()
+{
+	checking("parallel clear");
+
+	// Not a multiple of the chunk granularity on purpose
+	uint64_t const size = 9 * 1024 * 1024 + 4096;
+	unsigned char* p = reinterpret_cast<unsigned char*>(page_aligned_malloc( size ));
+	if( !p ) {
+		std::cerr << "Could not allocate memory" << std::endl;
+		abort();
+	}
+
+	for( unsigned int threads = 1; threads <= 5; ++threads ) {
+		memset( p, 0xff, size );
+		parallel_clear( p, size, threads );
+		for( uint64_t i = 0; i < size; ++i ) {
+			if( p[i] ) {
+				std::cerr << "Memory not cleared at offset " << i << " with " << threads << " threads" << std::endl;
+				abort();
+			}
+		}
+	}
+
+	aligned_free( p );
+
+	pass();
+}
+
+void check_pawn_hash_table()
+{
+	checking("pawn structure hash table");
+
+	pawn_structure_hash_table pawn_tt;
+	pawn_tt.init( 1 );
+
+	randgen rng;
+	uint64_t const base = rng.get_uint64() | 1;
+
+	// All in the same bucket, one more than fits. The oldest one needs to
+	// get replaced.
+	unsigned int const count = 3;
+	for( unsigned int i = 0; i < count; ++i ) {
+		uint64_t key = base ^ (static_cast<uint64_t>(i) << 40);
+		score eval[2] = { score( 10 + i, 20 + i ), score( -30 - i, -40 - i ) };
+		pawn_tt.store( key, eval, 1000 + i );
+	}
+
+	for( unsigned int i = 0; i < count; ++i ) {
+		uint64_t key = base ^ (static_cast<uint64_t>(i) << 40);
+
+		score found[2];
+		uint64_t passed = 0;
+		bool hit = pawn_tt.lookup( key, found, passed );
+		if( !i ) {
+			if( hit ) {
+				std::cerr << "Oldest pawn structure hash table entry did not get replaced.\n";
+				abort();
+			}
+		}
+		else if( !hit || found[0] != score( 10 + i, 20 + i ) || found[1] != score( -30 - i, -40 - i ) || passed != 1000 + i ) {
+			std::cerr << "Pawn structure hash table entry doesn't match stored one.\n";
+			abort();
+		}
+	}
+
+	// Storing an existing entry again must not push out the other one
+	uint64_t const second = base ^ (static_cast<uint64_t>(1) << 40);
+	score eval[2] = { score( 1, 2 ), score( 3, 4 ) };
+	pawn_tt.store( second, eval, 5 );
+
+	score found[2];
+	uint64_t passed = 0;
+	if( !pawn_tt.lookup( base ^ (static_cast<uint64_t>(2) << 40), found, passed ) || !pawn_tt.lookup( second, found, passed ) || passed != 5 ) {
+		std::cerr << "Updating pawn structure hash table entry replaced another one.\n";
+		abort();
+	}
+
+	pass();
+}
+
+
+void check_eval_cache()
+{
+	checking("evaluation cache");
+
+	eval_cache cache;
+
+	randgen rng;
+	uint64_t const key = rng.get_uint64() | (1ull << 63);
+
+	short eval;
+	if( cache.lookup( key, eval ) ) {
+		std::cerr << "Empty evaluation cache returned an entry.\n";
+		abort();
+	}
+
+	short const values[] = { 0, 1, -1, 12345, -12345, result::win_threshold, result::loss_threshold };
+	for( std::size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i ) {
+		cache.store( key, values[i] );
+		if( !cache.lookup( key, eval ) || eval != values[i] ) {
+			std::cerr << "Evaluation cache entry doesn't match stored one.\n";
+			abort();
+		}
+
+		// Same slot, different key
+		if( cache.lookup( key ^ (1ull << 40), eval ) ) {
+			std::cerr << "Evaluation cache returned an entry for a different key.\n";
+			abort();
+		}
+	}
+
+	cache.clear();
+	if( cache.lookup( key, eval ) ) {
+		std::cerr << "Cleared evaluation cache returned an entry.\n";
+		abort();
+	}
+
+	pass();
+}
+
+// Evaluates every third node incrementally, so that updates span several plies.
+void nnue_walk( context& ctx, nnue::accumulator_stack& stack, position& p, int depth, uint64_t& n )
+{
+	if( n++ % 3 == 0 || !depth ) {
+		short const incremental = stack.evaluate( p );
+		short const full = nnue::evaluate( p );
+		if( incremental != full ) {
+			std::cerr << "Incrementally updated network evaluation " << incremental << " differs from full evaluation " << full << std::endl;
+			std::cerr << "Fen: " << position_to_fen_noclock( ctx.conf_, p ) << std::endl;
+			abort();
+		}
+	}
+
+	if( !depth ) {
+		return;
+	}
+
+	check_map check( p );
+	std::vector<move> moves = calculate_moves<movegen_type::all>( p, check );
+	for( auto const& m : moves ) {
+		move_undo undo;
+		stack.push( p, m );
+		apply_move( p, m, undo );
+		nnue_walk( ctx, stack, p, depth - 1, n );
+		undo_move( p, m, undo );
+		stack.pop();
+	}
+}
+
+void check_nnue( context& ctx )
+{
+	checking("neural network evaluation");
+
+	std::vector<position> positions;
+	std::ifstream in_fen( ctx.conf_.self_dir + "test/testpositions.txt" );
+	std::string fen;
+	while( positions.size() < 500 && std::getline( in_fen, fen ) ) {
+		positions.push_back( test_parse_fen( ctx, fen ) );
+	}
+
+	nnue::randomize( 42 );
+	std::vector<short> reference;
+	for( auto const& p : positions ) {
+		reference.push_back( nnue::evaluate( p ) );
+	}
+
+	std::stringstream ss;
+	if( !nnue::save( ss ) ) {
+		std::cerr << "Could not save network" << std::endl;
+		abort();
+	}
+	nnue::randomize( 43 );
+	if( !nnue::load( ss ) ) {
+		std::cerr << "Could not load saved network" << std::endl;
+		abort();
+	}
+
+	std::stringstream truncated( ss.str().substr( 0, ss.str().size() - 1 ) );
+	std::stringstream trailing( ss.str() + "x" );
+	if( nnue::load( truncated ) || nnue::load( trailing ) ) {
+		std::cerr << "Loaded malformed network" << std::endl;
+		abort();
+	}
+
+	nnue::simd::type const best = nnue::best_simd();
+	for( int t = nnue::simd::scalar; t <= nnue::simd::avx2; ++t ) {
+		if( !nnue::set_simd( static_cast<nnue::simd::type>(t) ) ) {
+			continue;
+		}
+		for( std::size_t i = 0; i < positions.size(); ++i ) {
+			if( nnue::evaluate( positions[i] ) != reference[i] ) {
+				std::cerr << "Network evaluation with " << nnue::simd_name( static_cast<nnue::simd::type>(t) ) << " kernels differs from reference" << std::endl;
+				std::cerr << "Fen: " << position_to_fen_noclock( ctx.conf_, positions[i] ) << std::endl;
+				abort();
+			}
+		}
+	}
+	nnue::set_simd( best );
+
+	// Castling, en-passant and promotions
+	std::string const fens[] = {
+		"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq -",
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+		"r3k2r/8/8/8/3pPp2/8/8/R3K1RR b KQkq e3",
+		"n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - -"
+	};
+
+	nnue::set_enabled( true );
+	std::unique_ptr<nnue::accumulator_stack> stack( new nnue::accumulator_stack );
+	for( auto const& fen : fens ) {
+		position p = test_parse_fen( ctx, fen );
+		stack->reset( p );
+		uint64_t n = 0;
+		nnue_walk( ctx, *stack, p, 3, n );
+	}
+	nnue::set_enabled( false );
+
+	pass();
+}
+
 void check_tt( context& ctx)
 {
 	checking("transposition table");
@@ -1228,6 +2015,273 @@ void check_tt( context& ctx)
 	pass();
 }
 
+void check_dense_tt()
+{
+	checking("dense transposition table");
+
+	context ctx;
+	ctx.conf_.memory = 4;
+	ctx.conf_.tt_format = hash_format::dense;
+	ctx.tt_.init( ctx.conf_ );
+
+	randgen rng;
+	uint64_t const base = rng.get_uint64();
+
+	// All keys map to the same bucket, one more than fits. The entry with the
+	// lowest depth needs to get replaced.
+	unsigned int const count = 6;
+	for( unsigned int i = 0; i < count; ++i ) {
+		uint64_t key = base ^ (static_cast<uint64_t>(i + 1) << 40);
+		move bm;
+		bm.d = 100 + i;
+		ctx.tt_.store( key, 10 + i, 0, 50 + i, -1000, 1000, bm, 1, -3000 + i );
+	}
+
+	for( unsigned int i = 0; i < count; ++i ) {
+		uint64_t key = base ^ (static_cast<uint64_t>(i + 1) << 40);
+
+		short eval = result::win;
+		short fev = result::win;
+		move bm;
+		score_type::type t = ctx.tt_.lookup( key, 10, 0, -1000, 1000, eval, bm, fev );
+
+		if( !i ) {
+			if( t != score_type::none || !bm.empty() ) {
+				std::cerr << "Entry with lowest depth did not get replaced in dense transposition table.\n";
+				abort();
+			}
+		}
+		else if( t != score_type::exact || eval != static_cast<short>(50 + i) || bm.d != 100 + i || fev != static_cast<short>(-3000 + i) ) {
+			std::cerr << "Looked up dense transposition table entry doesn't match stored one.\n";
+			abort();
+		}
+	}
+
+	pass();
+}
+
+
+void check_tt_resize( hash_format::type format )
+{
+	checking(std::string("resizing ") + (format == hash_format::dense ? "dense " : "") + "transposition table");
+
+	context ctx;
+	ctx.conf_.memory = 8;
+	ctx.conf_.tt_format = format;
+	ctx.conf_.thread_count = 2;
+	ctx.tt_.init( ctx.conf_ );
+
+	randgen rng;
+
+	// Plenty of entries which must all survive growing the table. The dense
+	// format cannot tell their new buckets and has to drop them.
+	std::vector<uint64_t> keys;
+	for( unsigned int i = 0; i < 1000; ++i ) {
+		keys.push_back( rng.get_uint64() );
+		move bm;
+		bm.d = i;
+		ctx.tt_.store( keys.back(), 5, 0, i, -1000, 1000, bm, 1, i );
+	}
+
+	ctx.conf_.memory = 32;
+	ctx.tt_.init( ctx.conf_ );
+	for( unsigned int i = 0; i < keys.size(); ++i ) {
+		short eval = result::win;
+		short fev = result::win;
+		move bm;
+		score_type::type t = ctx.tt_.lookup( keys[i], 5, 0, -1000, 1000, eval, bm, fev );
+		if( format == hash_format::dense ) {
+			if( t != score_type::none || !bm.empty() ) {
+				std::cerr << "Entry found in wrong bucket after growing dense transposition table.\n";
+				abort();
+			}
+		}
+		else if( t != score_type::exact || eval != static_cast<short>(i) || bm.d != i || fev != static_cast<short>(i) ) {
+			std::cerr << "Entry lost after growing transposition table.\n";
+			abort();
+		}
+	}
+
+	// Six keys sharing a bucket in a 4 MiB table, bits 22 to 24 are part of
+	// the bucket index of the 32 MiB one. They also differ in bits stored by
+	// the dense format.
+	uint64_t const base = rng.get_uint64();
+	unsigned int const count = 6;
+	for( unsigned int i = 0; i < count; ++i ) {
+		uint64_t key = base ^ (static_cast<uint64_t>(i) << 22) ^ (static_cast<uint64_t>(i) << 40);
+		move bm;
+		bm.d = 100 + i;
+		ctx.tt_.store( key, 10 + i, 0, 50 + i, -1000, 1000, bm, 1, -3000 + i );
+	}
+
+	// Shrinking needs to keep the deepest entries
+	ctx.conf_.memory = 4;
+	ctx.tt_.init( ctx.conf_ );
+	unsigned int const kept = (format == hash_format::dense) ? 5 : 4;
+	for( unsigned int i = 0; i < count; ++i ) {
+		uint64_t key = base ^ (static_cast<uint64_t>(i) << 22) ^ (static_cast<uint64_t>(i) << 40);
+
+		short eval = result::win;
+		short fev = result::win;
+		move bm;
+		score_type::type t = ctx.tt_.lookup( key, 10, 0, -1000, 1000, eval, bm, fev );
+
+		if( i < count - kept ) {
+			if( t != score_type::none || !bm.empty() ) {
+				std::cerr << "Shallow entry kept after shrinking transposition table.\n";
+				abort();
+			}
+		}
+		else if( t != score_type::exact || eval != static_cast<short>(50 + i) || bm.d != 100 + i || fev != static_cast<short>(-3000 + i) ) {
+			std::cerr << "Deep entry lost after shrinking transposition table.\n";
+			abort();
+		}
+	}
+
+	pass();
+}
+
+#if UNIX
+void check_shared_tt()
+{
+	checking("shared transposition table");
+
+	randgen rng;
+	std::stringstream ss;
+	ss << "octochess-selftest-" << std::hex << rng.get_uint64();
+
+	config conf;
+	conf.memory = 4;
+	conf.thread_count = 1;
+	conf.shared_hash = ss.str();
+
+	uint64_t const key = rng.get_uint64();
+	move bm;
+	bm.d = 1234;
+
+	{
+		hash first;
+		hash second;
+		if( !first.init( conf ) || !first.shared() || !second.init( conf ) || !second.shared() ) {
+			std::cerr << "Could not attach to shared transposition table" << std::endl;
+			abort();
+		}
+
+		first.store( key, 23, 4, 556, -123, 99, bm, first.new_search( 1 ), -24 );
+
+		short eval = result::win;
+		short fev = result::win;
+		move bm2;
+		score_type::type t = second.lookup( key, 23, 4, -123, 99, eval, bm2, fev );
+		if( t != score_type::lower_bound || eval != 556 || bm2 != bm || fev != -24 ) {
+			std::cerr << "Entry stored in shared transposition table not visible to other user.\n";
+			abort();
+		}
+
+		// Ages come from a common counter, not from the passed clock
+		unsigned char age = first.new_search( 42 );
+		if( second.new_search( 42 ) != static_cast<unsigned char>(age + 1) ) {
+			std::cerr << "Shared transposition table does not have common ages.\n";
+			abort();
+		}
+
+		// Attaching with a different size must fail, falling back to a
+		// private table.
+		config other = conf;
+		other.memory = 8;
+		hash third;
+		std::streambuf* old = std::cerr.rdbuf( 0 );
+		bool success = third.init( other );
+		std::cerr.rdbuf( old );
+		if( !success || third.shared() ) {
+			std::cerr << "Attached to shared transposition table of different size.\n";
+			abort();
+		}
+	}
+
+	// Segment needs to be gone after the last user detached
+	hash fresh;
+	fresh.init( conf );
+
+	short eval = result::win;
+	short fev = result::win;
+	move bm2;
+	if( fresh.lookup( key, 0, 4, -123, 99, eval, bm2, fev ) != score_type::none || !bm2.empty() ) {
+		std::cerr << "Shared transposition table not removed after last user detached.\n";
+		abort();
+	}
+
+	pass();
+}
+#endif
+
+void check_tt_snapshot()
+{
+	checking("transposition table snapshot");
+
+	std::string const file = "selftest_hash.tmp";
+
+	randgen rng;
+	uint64_t const key = rng.get_uint64();
+	move bm;
+	bm.d = 1234;
+
+	{
+		hash tt;
+		tt.init( 4 );
+		tt.store( key, 23, 4, 556, -123, 99, bm, 55, -24 );
+		if( !tt.save( file, eval_version, 0 ) ) {
+			std::cerr << "Could not save transposition table" << std::endl;
+			abort();
+		}
+	}
+
+	hash tt;
+	tt.init( 4 );
+
+	// Snapshots from other evaluation versions or evaluators must be rejected
+	std::streambuf* old = std::cerr.rdbuf( 0 );
+	bool loaded = tt.load( file, eval_version + 1, 0 );
+	std::cerr.rdbuf( old );
+	if( loaded ) {
+		std::cerr << "Transposition table snapshot with wrong version got loaded" << std::endl;
+		abort();
+	}
+
+	old = std::cerr.rdbuf( 0 );
+	loaded = tt.load( file, eval_version, 1 );
+	std::cerr.rdbuf( old );
+	if( loaded ) {
+		std::cerr << "Transposition table snapshot from a different evaluator got loaded" << std::endl;
+		abort();
+	}
+
+	if( !tt.load( file, eval_version, 0 ) ) {
+		std::cerr << "Could not load transposition table" << std::endl;
+		abort();
+	}
+	std::remove( file.c_str() );
+
+	short eval = result::win;
+	short fev = result::win;
+	move bm2;
+	score_type::type t = tt.lookup( key, 23, 4, -123, 99, eval, bm2, fev );
+	if( t != score_type::lower_bound || eval != 556 || bm2 != bm || fev != -24 ) {
+		std::cerr << "Looked up entry from transposition table snapshot doesn't match stored one.\n";
+		abort();
+	}
+
+	// Table needs to remain usable
+	tt.store( key, 24, 4, 500, -123, 99, bm, 55, -24 );
+	t = tt.lookup( key, 24, 4, -123, 99, eval, bm2, fev );
+	if( t != score_type::lower_bound || eval != 500 ) {
+		std::cerr << "Transposition table not writable after loading snapshot.\n";
+		abort();
+	}
+
+	pass();
+}
+
 }
 
 bool selftest()
@@ -1235,10 +2289,11 @@ bool selftest()
 	// Start by checking basics
 	check_popcount();
 	check_bitscan();
+	check_slider_lookup();
 	check_time();
 
 	context ctx;
-	ctx.pawn_tt_.init( ctx.conf_.pawn_hash_table_size() );
+	ctx.pawn_tt_.init( ctx.conf_ );
 	ctx.tt_.init( 1 );
 
 	check_see( ctx );
@@ -1248,8 +2303,19 @@ bool selftest()
 	check_scale();
 	check_eval();
 	check_endgame_eval( ctx );
+	check_material_table( ctx );
 
 	check_tt( ctx );
+	check_pawn_hash_table();
+	check_eval_cache();
+	check_nnue( ctx );
+	check_dense_tt();
+	check_tt_resize( hash_format::standard );
+	check_tt_resize( hash_format::dense );
+	check_tt_snapshot();
+#if UNIX
+	check_shared_tt();
+#endif
 
 	test_pst();
 	test_incorrect_positions( ctx );
@@ -1262,8 +2328,11 @@ bool selftest()
 	check_condition_wait();
 
 	test_context_isolation();
+	test_smp();
+	test_parallel_clear();
 
 	test_perft( ctx );
+	test_parallel_perft( ctx );
 
 	std::cerr << "Self test passed" << std::endl;
 	return true;
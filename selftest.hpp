@@ -1,7 +1,28 @@
 #ifndef __SELFTEST_H__
 #define __SELFTEST_H__
 
-void perft( position const& p );
+class config;
+
+// Counts moves to increasing depths with parallel_perft, printing node rates
+void perft( config const& conf, position const& p );
+
+// Compares node rates of copy-make and make/unmake
+void perft_compare( position const& p, int depth );
+
+// Compares the speed of the supported ways to look up slider attacks
+void slider_benchmark();
+
+class context;
+
+// Searches a fixed set of positions to a fixed depth. The total node count
+// is a signature of the search, it changes only if the search does.
+// Defaults to 1 thread and 16 MB hash unless given with --threads and
+// --memory, --depth overrides the default depth.
+void bench( context& ctx );
+
+// Compares evaluation speed of the hand-crafted evaluation and of the neural
+// network with each supported set of kernels.
+void eval_benchmark( context& ctx );
 
 bool selftest();
 
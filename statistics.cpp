@@ -11,6 +11,20 @@
 
 #if USE_STATISTICS
 
+namespace {
+char const* page_type_name( page_type::type t )
+{
+	switch( t ) {
+	case page_type::huge:
+		return "huge";
+	case page_type::transparent_huge:
+		return "transparent huge";
+	default:
+		return "regular";
+	}
+}
+}
+
 #if USE_STATISTICS >= 2
 atomic_uint64_t statistics::full_eval_ = atomic_uint64_t();
 atomic_uint64_t statistics::endgame_eval_ = atomic_uint64_t();
@@ -71,6 +85,11 @@ void statistics::print( context& ctx, duration const& elapsed )
 
 	ss_ << "\n";
 
+	ss_ << "Memory pages:\n";
+	ss_ << "  Transposition table:  " << page_type_name( ctx.tt_.get_page_type() ) << "\n";
+	ss_ << "  Pawn structure table: " << page_type_name( ctx.pawn_tt_.get_page_type() ) << "\n";
+	ss_ << "\n";
+
 #if USE_STATISTICS >= 2
 	ss_ << "Transposition table stats:\n";
 	hash::stats s = ctx.tt_.get_stats( true );
@@ -101,16 +120,21 @@ void statistics::print( context& ctx, duration const& elapsed )
 	}
 	ss_ << "\n";
 	ss_ << "- Index collisions:  " << std::setw(11) << s.index_collisions << "\n";
+	ss_ << "- Type-1 collisions: " << std::setw(11) << s.type1_collisions;
+	if( s.hits + s.best_move ) {
+		ss_ << " (" << static_cast<double>(s.type1_collisions) / (s.hits + s.best_move) * 100 << "% of hits)";
+	}
+	ss_ << "\n";
 
 	pawn_structure_hash_table::stats ps = ctx.pawn_tt_.get_stats(true);
 
 	ss_ << "\n";
 	ss_ << "Pawn structure hash table stats:\n";
 	ss_ << "- Entries:    " << std::setw(11) << ps.fill;
-	uint64_t max_pawn_hash_entry_count = ctx.tt_.max_hash_entry_count();
+	uint64_t max_pawn_hash_entry_count = ctx.pawn_tt_.max_hash_entry_count();
 	if( max_pawn_hash_entry_count ) {
-		if( ps.fill > max_hash_entry_count ) {
-			ps.fill = max_hash_entry_count;
+		if( ps.fill > max_pawn_hash_entry_count ) {
+			ps.fill = max_pawn_hash_entry_count;
 		}
 		ss_ << " (" << 100 * static_cast<double>(ps.fill) / max_pawn_hash_entry_count << "%)";
 	}
@@ -140,13 +164,31 @@ void statistics::print( context& ctx, duration const& elapsed )
 		ss_ << " (" << 100 * static_cast<double>(endgame_eval_) / (full_eval_ + endgame_eval_) << "%)";
 	}
 	ss_ << "\n\n";
-#else
-	(void)ctx;
 #endif
 
 	dlog() << ss_.str();
 }
 
+#if USE_STATISTICS >= 2
+void statistics::print_thread_pawn_stats( std::vector<pawn_structure_hash_table*> const& tables )
+{
+	ss_.str( std::string() );
+
+	ss_ << "Per-thread pawn structure hash table stats:\n";
+	for( std::size_t i = 0; i < tables.size(); ++i ) {
+		pawn_structure_hash_table::stats ps = tables[i]->get_stats(true);
+		ss_ << "- Thread " << std::setw(3) << i << " hits: " << std::setw(11) << ps.hits;
+		if( ps.hits + ps.misses ) {
+			ss_ << " (" << 100 * static_cast<double>(ps.hits) / (ps.hits + ps.misses) << "%)";
+		}
+		ss_ << ", misses: " << std::setw(11) << ps.misses << "\n";
+	}
+	ss_ << "\n";
+
+	dlog() << ss_.str();
+}
+#endif
+
 void statistics::print_total()
 {
 	ss_.str( std::string() );
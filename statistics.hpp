@@ -13,9 +13,11 @@
 #include "util/time.hpp"
 #include "util/atomic.hpp"
 #include <sstream>
+#include <vector>
 
 #if USE_STATISTICS
 class context;
+class pawn_structure_hash_table;
 class statistics {
 public:
 	statistics();
@@ -45,6 +47,9 @@ public:
 #if USE_STATISTICS >= 2
 	void add_cutoff( int processed );
 
+	// Hit rates of per-thread pawn structure hash tables
+	void print_thread_pawn_stats( std::vector<pawn_structure_hash_table*> const& tables );
+
 	static atomic_uint64_t full_eval_;
 	static atomic_uint64_t endgame_eval_;
 #endif
@@ -73,7 +73,7 @@ static void generate_test_positions_impl( context& ctx )
 	ctx.conf_.max_moves = 20 + rng.get_uint64() % 70;
 
 	ctx.tt_.clear_data();
-	ctx.pawn_tt_.init( ctx.conf_.pawn_hash_table_size() );
+	ctx.pawn_tt_.init( ctx.conf_ );
 	position p;
 
 	unsigned int i = 1;
@@ -125,7 +125,7 @@ static void generate_test_positions_impl( context& ctx )
 
 void generate_test_positions( context& ctx )
 {
-	ctx.tt_.init( ctx.conf_.memory );	
+	ctx.tt_.init( ctx.conf_ );	
 	ctx.conf_.set_max_search_depth( 6 );
 	
 	while( true ) {
@@ -139,6 +139,18 @@ class gene_t
 public:
 	gene_t( short* target, short min, short max )
 		: target_(target)
+		, score_target_()
+		, endgame_()
+		, min_(min)
+		, max_(max)
+	{
+	}
+
+	// Score halves are packed and cannot be addressed directly
+	gene_t( score* target, bool endgame, short min, short max )
+		: target_()
+		, score_target_(target)
+		, endgame_(endgame)
 		, min_(min)
 		, max_(max)
 	{
@@ -146,14 +158,37 @@ public:
 
 	gene_t()
 		: target_()
+		, score_target_()
+		, endgame_()
 		, min_()
 		, max_()
 	{
 	}
 
-	short value() const { return *target_; }
+	short value() const {
+		if( score_target_ ) {
+			return endgame_ ? score_target_->eg() : score_target_->mg();
+		}
+		return *target_;
+	}
+
+	void set( short v ) const {
+		if( score_target_ ) {
+			if( endgame_ ) {
+				score_target_->set_eg( v );
+			}
+			else {
+				score_target_->set_mg( v );
+			}
+		}
+		else {
+			*target_ = v;
+		}
+	}
 
 	short* target_;
+	score* score_target_;
+	bool endgame_;
 	short min_;
 	short max_;
 };
@@ -192,9 +227,9 @@ public:
 		: tweak_base(name)
 	{
 		genes_.push_back(static_cast<int>(genes.size()));
-		genes.push_back(gene_t( &target.mg(), min, max ) );
+		genes.push_back( gene_t( &target, false, min, max ) );
 		genes_.push_back(static_cast<int>(genes.size()));
-		genes.push_back( gene_t( &target.eg(), min, max ) );
+		genes.push_back( gene_t( &target, true, min, max ) );
 	}
 
 	virtual std::string to_string() const {
@@ -341,7 +376,7 @@ struct individual
 		, max_diff_()
 	{
 		for( unsigned int i = 0; i < genes.size(); ++i ) {
-			values_.push_back( *genes[i].target_ );
+			values_.push_back( genes[i].value() );
 		}
 	}
 
@@ -356,7 +391,7 @@ struct individual
 	bool apply()
 	{
 		for( unsigned int i = 0; i < values_.size(); ++i ) {
-			*genes[i].target_ = values_[i];
+			genes[i].set( values_[i] );
 		}
 
 		bool changed = false;
@@ -372,7 +407,7 @@ struct individual
 
 		if( changed ) {
 			for( unsigned int i = 0; i < genes.size(); ++i ) {
-				values_[i] = *genes[i].target_;
+				values_[i] = genes[i].value();
 			}
 		}
 		return true;
@@ -780,7 +815,7 @@ void add_random( pawn_structure_hash_table& pawn_tt, population & pop, std::set<
 void tweak_evaluation( context& ctx )
 {
 	rng.seed();
-	ctx.pawn_tt_.init( ctx.conf_.pawn_hash_table_size(), true );
+	ctx.pawn_tt_.init( ctx.conf_, true );
 	std::vector<reference_data> data = load_data( ctx );
 
 	init_genes();
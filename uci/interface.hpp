@@ -34,6 +34,10 @@ public:
 	virtual void quit() = 0;
 	virtual bool is_move( std::string const& ms ) = 0;
 
+	// Transposition table snapshots
+	virtual void save_hash( std::string const& file ) = 0;
+	virtual void load_hash( std::string const& file ) = 0;
+
 	//generic info
 	virtual std::string name() const = 0;
 	virtual std::string author() const = 0;
@@ -45,6 +49,20 @@ public:
 	virtual unsigned int get_threads() const = 0;
 	virtual unsigned int get_max_threads() const = 0;
 	virtual void set_threads( unsigned int threads ) = 0;
+	virtual bool lazy_smp() const = 0;
+	virtual void lazy_smp( bool lazy ) = 0;
+	virtual bool numa() const = 0;
+	virtual void numa( bool numa ) = 0;
+	virtual bool dense_hash() const = 0;
+	virtual void dense_hash( bool dense ) = 0;
+	virtual std::string shared_hash() const = 0; // Empty if not shared
+	virtual void shared_hash( std::string const& name ) = 0;
+	virtual bool per_thread_pawn_hash() const = 0;
+	virtual void per_thread_pawn_hash( bool per_thread ) = 0;
+	virtual bool use_nnue() const = 0;
+	virtual void use_nnue( bool use ) = 0;
+	virtual std::string nnue_file() const = 0; // Empty if none
+	virtual void nnue_file( std::string const& file ) = 0;
 	virtual bool use_book() const = 0;
 	virtual void use_book( bool use ) = 0;
 	virtual void set_multipv( unsigned int multipv ) = 0;
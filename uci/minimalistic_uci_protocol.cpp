@@ -55,7 +55,14 @@ void minimalistic_uci_protocol::init()
 void minimalistic_uci_protocol::send_options()
 {
 	std::cout << "option name Hash type spin default " << callbacks_->get_hash_size() << " min " << callbacks_->get_min_hash_size() << " max 1048576" << "\n";
+	std::cout << "option name HashFormat type combo default " << (callbacks_->dense_hash() ? "Dense" : "Standard") << " var Standard var Dense\n";
 	std::cout << "option name Threads type spin default " << callbacks_->get_threads() << " min 1 max " << callbacks_->get_max_threads() << "\n";
+	std::cout << "option name SMP type combo default " << (callbacks_->lazy_smp() ? "Lazy" : "YBWC") << " var YBWC var Lazy\n";
+	std::cout << "option name NUMA type check default " << (callbacks_->numa() ? "true" : "false") << "\n";
+	std::cout << "option name PerThreadPawnHash type check default " << (callbacks_->per_thread_pawn_hash() ? "true" : "false") << "\n";
+	std::cout << "option name SharedHash type string default " << (callbacks_->shared_hash().empty() ? "<empty>" : callbacks_->shared_hash()) << "\n";
+	std::cout << "option name UseNNUE type check default " << (callbacks_->use_nnue() ? "true" : "false") << "\n";
+	std::cout << "option name EvalFile type string default " << (callbacks_->nnue_file().empty() ? "<empty>" : callbacks_->nnue_file()) << "\n";
 	std::cout << "option name OwnBook type check default " << (callbacks_->use_book() ? "true" : "false") << "\n";
 	std::cout << "option name Ponder type check default true\n";
 	std::cout << "option name MultiPV type spin default 1 min 1 max 99\n";
@@ -87,6 +94,17 @@ void minimalistic_uci_protocol::handle_option( std::string const& args )
 			callbacks_->set_hash_size( memory );
 		}
 	}
+	else if( name == "HashFormat" ) {
+		if( value == "Standard" ) {
+			callbacks_->dense_hash( false );
+		}
+		else if( value == "Dense" ) {
+			callbacks_->dense_hash( true );
+		}
+		else {
+			std::cerr << "malformed setoption: " << args << std::endl;
+		}
+	}
 	else if( name == "Threads" ) {
 		int threads;
 		if( !to_int<int>( value, threads, 1, callbacks_->get_max_threads() ) ) {
@@ -96,6 +114,59 @@ void minimalistic_uci_protocol::handle_option( std::string const& args )
 			callbacks_->set_threads( threads );
 		}
 	}
+	else if( name == "SMP" ) {
+		if( value == "YBWC" ) {
+			callbacks_->lazy_smp( false );
+		}
+		else if( value == "Lazy" ) {
+			callbacks_->lazy_smp( true );
+		}
+		else {
+			std::cerr << "malformed setoption: " << args << std::endl;
+		}
+	}
+	else if( name == "NUMA" ) {
+		bool numa;
+		if( !to_bool( value, numa ) ) {
+			std::cerr << "malformed setoption: " << args << std::endl;
+		}
+		else {
+			callbacks_->numa( numa );
+		}
+	}
+	else if( name == "PerThreadPawnHash" ) {
+		bool per_thread;
+		if( !to_bool( value, per_thread ) ) {
+			std::cerr << "malformed setoption: " << args << std::endl;
+		}
+		else {
+			callbacks_->per_thread_pawn_hash( per_thread );
+		}
+	}
+	else if( name == "SharedHash" ) {
+		// Name of the shared memory segment, shared with all other engine
+		// processes using the same name.
+		if( value == "<empty>" ) {
+			value.clear();
+		}
+		callbacks_->shared_hash( value );
+	}
+	else if( name == "UseNNUE" ) {
+		bool use;
+		if( !to_bool( value, use ) ) {
+			std::cerr << "malformed setoption: " << args << std::endl;
+		}
+		else {
+			callbacks_->use_nnue( use );
+		}
+	}
+	else if( name == "EvalFile" ) {
+		// Network file for the neural network evaluation
+		if( value == "<empty>" ) {
+			value.clear();
+		}
+		callbacks_->nnue_file( value );
+	}
 	else if( name == "OwnBook" ) {
 		bool use_book;
 		if( !to_bool( value, use_book ) ) {
@@ -171,6 +242,12 @@ bool minimalistic_uci_protocol::parse_command( std::string const& line ) {
 	else if( cmd == "setoption" ) {
 		handle_option( args );
 	}
+	else if( cmd == "savehash" ) {
+		callbacks_->save_hash( args );
+	}
+	else if( cmd == "loadhash" ) {
+		callbacks_->load_hash( args );
+	}
 	else {
 		std::cerr << "unknown command when connected: " << line << std::endl;
 	}
@@ -9,6 +9,7 @@
 #include "../eval.hpp"
 #include "../fen.hpp"
 #include "../hash.hpp"
+#include "../nnue.hpp"
 #include "../pawn_structure_hash_table.hpp"
 #include "../state_base.hpp"
 #include "../util/logger.hpp"
@@ -65,7 +66,7 @@ octochess_uci::octochess_uci( context& ctx,  gui_interface_ptr const& p )
 {
 	p->set_engine_interface(*this);
 
-	ctx.pawn_tt_.init( ctx.conf_.pawn_hash_table_size() );
+	ctx.pawn_tt_.init( ctx.conf_ );
 	new_game();
 }
 
@@ -91,7 +92,7 @@ void octochess_uci::set_position( std::string const& fen ) {
 		}
 	}
 
-	impl_->ctx_.tt_.init( impl_->ctx_.conf_.memory );
+	impl_->ctx_.tt_.init( impl_->ctx_.conf_ );
 }
 
 void octochess_uci::make_moves( std::string const& moves ) {
@@ -115,7 +116,7 @@ void octochess_uci::make_moves( std::vector<std::string> const& moves )
 
 void octochess_uci::calculate( timestamp const& start, calculate_mode_type mode, position_time const& t, int depth, bool ponder, std::string const& searchmoves )
 {
-	impl_->ctx_.tt_.init( impl_->ctx_.conf_.memory );
+	impl_->ctx_.tt_.init( impl_->ctx_.conf_ );
 
 	impl_->calc_manager_.abort();
 	impl_->join();
@@ -347,6 +348,101 @@ void octochess_uci::set_threads( unsigned int threads )
 }
 
 
+bool octochess_uci::lazy_smp() const
+{
+	return impl_->ctx_.conf_.smp == smp_mode::lazy;
+}
+
+
+void octochess_uci::lazy_smp( bool lazy )
+{
+	impl_->ctx_.conf_.smp = lazy ? smp_mode::lazy : smp_mode::ybwc;
+}
+
+
+bool octochess_uci::numa() const
+{
+	return impl_->ctx_.conf_.numa;
+}
+
+
+void octochess_uci::numa( bool numa )
+{
+	impl_->ctx_.conf_.numa = numa;
+}
+
+
+bool octochess_uci::dense_hash() const
+{
+	return impl_->ctx_.conf_.tt_format == hash_format::dense;
+}
+
+
+void octochess_uci::dense_hash( bool dense )
+{
+	impl_->ctx_.conf_.tt_format = dense ? hash_format::dense : hash_format::standard;
+}
+
+
+std::string octochess_uci::shared_hash() const
+{
+	return impl_->ctx_.conf_.shared_hash;
+}
+
+
+void octochess_uci::shared_hash( std::string const& name )
+{
+	impl_->ctx_.conf_.shared_hash = name;
+}
+
+
+bool octochess_uci::per_thread_pawn_hash() const
+{
+	return impl_->ctx_.conf_.per_thread_pawn_hash;
+}
+
+
+void octochess_uci::per_thread_pawn_hash( bool per_thread )
+{
+	impl_->ctx_.conf_.per_thread_pawn_hash = per_thread;
+}
+
+
+bool octochess_uci::use_nnue() const
+{
+	return impl_->ctx_.conf_.use_nnue;
+}
+
+
+void octochess_uci::use_nnue( bool use )
+{
+	// The transposition table holds evaluations of the previous evaluator.
+	impl_->calc_manager_.abort();
+	impl_->join();
+
+	impl_->ctx_.conf_.use_nnue = use;
+	nnue::init( impl_->ctx_.conf_ );
+	impl_->ctx_.tt_.init( impl_->ctx_.conf_, true );
+}
+
+
+std::string octochess_uci::nnue_file() const
+{
+	return impl_->ctx_.conf_.nnue_file;
+}
+
+
+void octochess_uci::nnue_file( std::string const& file )
+{
+	impl_->calc_manager_.abort();
+	impl_->join();
+
+	impl_->ctx_.conf_.nnue_file = file;
+	nnue::init( impl_->ctx_.conf_ );
+	impl_->ctx_.tt_.init( impl_->ctx_.conf_, true );
+}
+
+
 bool octochess_uci::use_book() const
 {
 	return impl_->book_.is_open();
@@ -384,6 +480,27 @@ bool octochess_uci::is_move( std::string const& ms )
 }
 
 
+void octochess_uci::save_hash( std::string const& file )
+{
+	if( impl_->ctx_.tt_.save( file, eval_version, nnue::evaluator_id() ) ) {
+		std::cerr << "Saved transposition table to " << file << std::endl;
+	}
+}
+
+
+void octochess_uci::load_hash( std::string const& file )
+{
+	// Table memory gets replaced, cannot have a search running.
+	impl_->calc_manager_.abort();
+	impl_->join();
+
+	impl_->ctx_.tt_.init( impl_->ctx_.conf_ );
+	if( impl_->ctx_.tt_.load( file, eval_version, nnue::evaluator_id() ) ) {
+		std::cerr << "Loaded transposition table from " << file << std::endl;
+	}
+}
+
+
 void octochess_uci::fischer_random( bool frc )
 {
 	impl_->ctx_.conf_.fischer_random = frc;
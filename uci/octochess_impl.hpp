@@ -24,6 +24,8 @@ public:
 	virtual void stop() override;
 	virtual void quit() override;
 	virtual bool is_move( std::string const& ms ) override;
+	virtual void save_hash( std::string const& file ) override;
+	virtual void load_hash( std::string const& file ) override;
 
 	//generic info
 	virtual std::string name() const;
@@ -36,6 +38,20 @@ public:
 	virtual unsigned int get_threads() const;
 	virtual unsigned int get_max_threads() const;
 	virtual void set_threads( unsigned int threads );
+	virtual bool lazy_smp() const;
+	virtual void lazy_smp( bool lazy );
+	virtual bool numa() const;
+	virtual void numa( bool numa );
+	virtual bool dense_hash() const;
+	virtual void dense_hash( bool dense );
+	virtual std::string shared_hash() const;
+	virtual void shared_hash( std::string const& name );
+	virtual bool per_thread_pawn_hash() const;
+	virtual void per_thread_pawn_hash( bool per_thread );
+	virtual bool use_nnue() const;
+	virtual void use_nnue( bool use );
+	virtual std::string nnue_file() const;
+	virtual void nnue_file( std::string const& file );
 	virtual bool use_book() const;
 	virtual void use_book( bool use );
 	virtual void set_multipv( unsigned int multipv );
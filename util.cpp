@@ -828,6 +828,116 @@ void apply_move( position& p, move const& m )
 }
 
 
+void apply_move( position& p, move const& m, move_undo& undo )
+{
+	undo.hash_ = p.hash_;
+	undo.pawn_hash = p.pawn_hash;
+	undo.piece_sum = p.piece_sum;
+	undo.pawn_control[color::white] = p.bitboards[color::white][bb_type::pawn_control];
+	undo.pawn_control[color::black] = p.bitboards[color::black][bb_type::pawn_control];
+	undo.material[color::white] = p.material[color::white];
+	undo.material[color::black] = p.material[color::black];
+	undo.base_eval = p.base_eval;
+	undo.halfmoves_since_pawnmove_or_capture = p.halfmoves_since_pawnmove_or_capture;
+	undo.castle[color::white] = p.castle[color::white];
+	undo.castle[color::black] = p.castle[color::black];
+	undo.can_en_passant = p.can_en_passant;
+	undo.captured = m.castle() ? pieces_with_color::none : p.board[m.target()];
+
+	apply_move( p, m );
+}
+
+
+void undo_move( position& p, move const& m, move_undo const& undo )
+{
+	p.c = p.other();
+
+	p.hash_ = undo.hash_;
+	p.pawn_hash = undo.pawn_hash;
+	p.piece_sum = undo.piece_sum;
+	p.bitboards[color::white][bb_type::pawn_control] = undo.pawn_control[color::white];
+	p.bitboards[color::black][bb_type::pawn_control] = undo.pawn_control[color::black];
+	p.material[color::white] = undo.material[color::white];
+	p.material[color::black] = undo.material[color::black];
+	p.base_eval = undo.base_eval;
+	p.halfmoves_since_pawnmove_or_capture = undo.halfmoves_since_pawnmove_or_capture;
+	p.castle[color::white] = undo.castle[color::white];
+	p.castle[color::black] = undo.castle[color::black];
+	p.can_en_passant = undo.can_en_passant;
+
+	uint64_t const source_square = 1ull << m.source();
+	uint64_t const target_square = 1ull << m.target();
+
+	if( m.castle() ) {
+		bool kingside = (m.target() % 8) == 6;
+
+		uint64_t rook = kingside ? bitscan_reverse(p.castle[p.c]) : bitscan(p.castle[p.c]);
+		unsigned char row = p.white() ? 0 : 56;
+		unsigned char rook_target = row + (kingside ? 5 : 3);
+
+		// Same toggles as in apply_move
+		p.bitboards[p.self()][bb_type::all_pieces] ^= source_square | (1ull << (row + rook));
+		p.bitboards[p.self()][bb_type::king] ^= source_square;
+		p.bitboards[p.self()][bb_type::rooks] ^= 1ull << (row + rook);
+		if( kingside ) {
+			p.bitboards[p.self()][bb_type::all_pieces] ^= 0x60ull << row;
+			p.bitboards[p.self()][bb_type::king] ^= 0x40ull << row;
+			p.bitboards[p.self()][bb_type::rooks] ^= 0x20ull << row;
+		}
+		else {
+			p.bitboards[p.self()][bb_type::all_pieces] ^= 0x0cull << row;
+			p.bitboards[p.self()][bb_type::king] ^= 0x04ull << row;
+			p.bitboards[p.self()][bb_type::rooks] ^= 0x08ull << row;
+		}
+
+		// In Fischer random chess, source and target squares can overlap.
+		// First empty the targets, then fill the sources.
+		pieces_with_color::type king = p.board[m.target()];
+		pieces_with_color::type rook_pwc = p.board[rook_target];
+		p.board[m.target()] = pieces_with_color::none;
+		p.board[rook_target] = pieces_with_color::none;
+		p.board[row + rook] = rook_pwc;
+		p.board[m.source()] = king;
+
+		p.king_pos[p.self()] = static_cast<square::type>(m.source());
+	}
+	else {
+		pieces_with_color::type pwc = p.board[m.target()];
+		pieces::type target_piece = get_piece( pwc );
+		pieces::type piece = target_piece;
+		if( m.promotion() ) {
+			piece = pieces::pawn;
+			pwc = static_cast<pieces_with_color::type>(pieces::pawn + (p.white() ? 0 : 8));
+		}
+
+		p.bitboards[p.self()][piece] ^= source_square;
+		p.bitboards[p.self()][target_piece] ^= target_square;
+		p.bitboards[p.self()][bb_type::all_pieces] ^= source_square | target_square;
+		p.board[m.source()] = pwc;
+		p.board[m.target()] = undo.captured;
+
+		if( undo.captured != pieces_with_color::none ) {
+			p.bitboards[p.other()][get_piece( undo.captured )] ^= target_square;
+			p.bitboards[p.other()][bb_type::all_pieces] ^= target_square;
+		}
+		else if( m.enpassant() ) {
+			unsigned char ep = (m.target() & 0x7) | (m.source() & 0x38);
+			uint64_t const ep_square = 1ull << ep;
+			p.bitboards[p.other()][bb_type::pawns] ^= ep_square;
+			p.bitboards[p.other()][bb_type::all_pieces] ^= ep_square;
+			p.board[ep] = static_cast<pieces_with_color::type>(pieces::pawn + (p.white() ? 8 : 0));
+		}
+
+		if( piece == pieces::king ) {
+			p.king_pos[p.self()] = static_cast<square::type>(m.source());
+		}
+	}
+
+#if VERIFY_POSITION
+	p.verify_abort();
+#endif
+}
+
 void position::init_pawn_hash()
 {
 	pawn_hash = 0;
@@ -24,6 +24,30 @@ std::string move_to_long_algebraic( config const& conf, position const& p, move
 
 void apply_move( position& p, move const& m );
 
+/*
+ * What apply_move cannot recompute when taking back a move: The position's
+ * scalar state before the move and the captured piece.
+ */
+struct move_undo
+{
+	uint64_t hash_;
+	uint64_t pawn_hash;
+	uint64_t piece_sum;
+	bitboard pawn_control[2];
+	score material[2];
+	score base_eval;
+	unsigned int halfmoves_since_pawnmove_or_capture;
+	unsigned char castle[2];
+	unsigned char can_en_passant;
+	pieces_with_color::type captured;
+};
+
+// Like apply_move, but remembers what undo_move needs to take the move back.
+void apply_move( position& p, move const& m, move_undo& undo );
+
+// Restores the position before apply_move( p, m, undo ) was called.
+void undo_move( position& p, move const& m, move_undo const& undo );
+
 // Checks if the given move is legal in the given position.
 // Precondition: There must be some position where the move is legal, else the result is undefined.
 //				 e.g. is_valid_move might return true on Na1b1
@@ -16,6 +16,17 @@ inline void atomic_store( atomic_uint64_t& a, uint64_t v )
 	a.store( v );
 }
 
+// Returns the new value
+inline uint64_t add_fetch( atomic_uint64_t& a, uint64_t v )
+{
+	return a.fetch_add( v ) + v;
+}
+
+inline uint64_t sub_fetch( atomic_uint64_t& a, uint64_t v )
+{
+	return a.fetch_sub( v ) - v;
+}
+
 #else
 // On some platforms, std::atomic is not available due to no kernel helper,
 // e.g. Kindle and other ARM devices.
@@ -36,6 +47,16 @@ inline void atomic_store( atomic_uint64_t& a, uint64_t v )
 	a = v;
 }
 
+inline uint64_t add_fetch( atomic_uint64_t& a, uint64_t v )
+{
+	return a += v;
+}
+
+inline uint64_t sub_fetch( atomic_uint64_t& a, uint64_t v )
+{
+	return a -= v;
+}
+
 #endif
 
 #endif
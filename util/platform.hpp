@@ -14,10 +14,12 @@
   #include "unix.hpp"
 #endif
 
+// Scaling beyond 64 threads has not been measured, larger pools need to be
+// asked for, e.g. with make MAX_THREADS=256.
 #ifndef MAX_THREADS
 #define MAX_THREADS 64
 #else
-static_assert( MAX_THREADS >= 1 && MAX_THREADS <= 64, "MAX_THREADS needs to be between 1 and 64 inclusive." );
+static_assert( MAX_THREADS >= 1, "MAX_THREADS needs to be at least 1." );
 #endif
 
 /*
@@ -29,9 +31,66 @@ void* page_aligned_malloc( uint64_t size );
 
 void aligned_free( void* p );
 
+namespace page_type {
+enum type {
+	regular,
+
+	// Transparent huge pages, kernel may or may not honor the request.
+	transparent_huge,
+
+	// Explicitly reserved huge pages
+	huge
+};
+}
+
+/*
+ * Like page_aligned_malloc, but tries to back the memory block with huge
+ * pages to reduce TLB misses. First tries explicitly reserved huge pages,
+ * then transparent huge pages, falling back to regular pages.
+ * type receives the kind of pages used. Blocks backed by huge pages
+ * start at a huge page boundary.
+ * Needs to be freed using aligned_free.
+ */
+void* huge_page_malloc( uint64_t size, page_type::type& type );
+
+/*
+ * Maps a named shared memory segment of size bytes that other processes
+ * can map as well. The segment gets created if it does not exist yet, in
+ * which case created is set and the memory is zeroed.
+ * Returns 0 on failure or if an existing segment has a different size.
+ * Needs to be freed using aligned_free. The segment itself persists until
+ * removed with remove_shared_memory.
+ */
+void* map_shared_memory( char const* name, uint64_t size, bool& created );
+
+void remove_shared_memory( char const* name );
+
 // Returns the system's memory page size.
 uint64_t get_page_size();
 
+/*
+ * NUMA support, only implemented on Linux. On other systems or on machines
+ * without NUMA, everything appears to be on a single node and the functions
+ * below do nothing.
+ */
+unsigned int get_numa_node_count();
+
+// Pins the calling thread to a logical processor. Consecutive thread indexes
+// get distributed round-robin across the NUMA nodes.
+// Returns the node the thread got pinned to.
+unsigned int pin_thread( uint64_t thread_index );
+
+// Allows the calling thread to run on all processors again.
+void unpin_thread();
+
+// Binds the pages of a page-aligned memory block to the given node.
+// Pages that have already been touched get migrated.
+bool bind_memory_to_node( void* p, uint64_t size, unsigned int node );
+
+// Interleaves the pages of a page-aligned memory block across all nodes.
+// Only affects pages not yet touched.
+bool interleave_memory( void* p, uint64_t size );
+
 // Forward bitscan, returns zero-based index of lowest set bit and nulls said bit.
 // Precondition: mask != 0
 inline uint64_t bitscan_unset( uint64_t& mask ) {
@@ -51,6 +110,16 @@ inline uint64_t generic_popcount( uint64_t w )
 bool uses_native_popcnt();
 bool cpu_has_popcnt();
 
+// Instruction set extensions used by optional vectorized code paths, which
+// get selected at runtime.
+bool cpu_has_sse41();
+bool cpu_has_avx2();
+bool cpu_has_bmi2();
+
+// PEXT is implemented in microcode on AMD CPUs before Zen 3, slower than
+// a multiplication and table lookup.
+bool cpu_has_fast_pext();
+
 void millisleep( int ms );
 
 #endif
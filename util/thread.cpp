@@ -1,7 +1,11 @@
 #include "thread.hpp"
 #include "platform.hpp"
 
+#include <algorithm>
+#include <vector>
+
 #include <stdlib.h>
+#include <string.h>
 
 #if WINDOWS
 namespace {
@@ -136,3 +140,19 @@ void thread::spawn()
 
 	impl_->spawn( this );
 }
+
+
+void parallel_clear( void* p, uint64_t size, unsigned int thread_count )
+{
+	// Chunks are multiples of the huge page size so that no page of a block
+	// from huge_page_malloc, which is aligned to it, gets touched by more
+	// than one thread.
+	uint64_t const granularity = 2 * 1024 * 1024;
+
+	unsigned char* start = reinterpret_cast<unsigned char*>(p);
+	parallel_for( (size + granularity - 1) / granularity, thread_count, [start, size, granularity]( uint64_t begin, uint64_t end ) {
+		uint64_t const first = begin * granularity;
+		uint64_t const last = std::min( size, end * granularity );
+		memset( start + first, 0, last - first );
+	} );
+}
@@ -1,6 +1,11 @@
 #ifndef __THREAD_HPP__
 #define __THREAD_HPP__
 
+#include "platform.hpp"
+
+#include <algorithm>
+#include <vector>
+
 class thread {
 	class impl;
 public:
@@ -21,4 +26,65 @@ private:
 	impl* impl_;
 };
 
+namespace detail {
+template<typename F>
+class range_thread : public thread
+{
+public:
+	range_thread( F const& f, uint64_t begin, uint64_t end )
+		: f_(f)
+		, begin_(begin)
+		, end_(end)
+	{
+	}
+
+	virtual void onRun()
+	{
+		f_( begin_, end_ );
+	}
+
+private:
+	F const& f_;
+	uint64_t begin_;
+	uint64_t end_;
+};
+}
+
+// Splits [0, count) into consecutive ranges, calling f( begin, end ) for
+// each on up to thread_count threads. Returns once all are done.
+template<typename F>
+void parallel_for( uint64_t count, unsigned int thread_count, F const& f )
+{
+	if( thread_count > count ) {
+		thread_count = static_cast<unsigned int>(count);
+	}
+	if( thread_count <= 1 ) {
+		if( count ) {
+			f( 0, count );
+		}
+		return;
+	}
+
+	uint64_t const per_thread = (count + thread_count - 1) / thread_count;
+
+	std::vector<detail::range_thread<F>*> threads;
+	for( uint64_t begin = per_thread; begin < count; begin += per_thread ) {
+		detail::range_thread<F>* t = new detail::range_thread<F>( f, begin, std::min( count, begin + per_thread ) );
+		threads.push_back( t );
+		t->spawn();
+	}
+
+	// First range is done by the calling thread
+	f( 0, per_thread );
+
+	for( auto t : threads ) {
+		t->join();
+		delete t;
+	}
+}
+
+// Zeroes a memory block, splitting the work across thread_count threads.
+// Also useful to first-touch freshly allocated memory in parallel.
+void parallel_clear( void* p, uint64_t size, unsigned int thread_count );
+
 #endif
@@ -0,0 +1,67 @@
+#ifndef OCTOCHESS_THREAD_SET_HEADER
+#define OCTOCHESS_THREAD_SET_HEADER
+
+#include "platform.hpp"
+
+/*
+ * Set of thread indexes in the range [0, MAX_THREADS).
+ *
+ * Replaces a plain uint64_t bitmask so that more than 64 threads can be
+ * tracked. For MAX_THREADS <= 64 it compiles down to a single word.
+ */
+class thread_set
+{
+public:
+	thread_set()
+		: words_()
+	{
+	}
+
+	void set( uint64_t index ) {
+		words_[index / 64] |= 1ull << (index % 64);
+	}
+
+	void reset( uint64_t index ) {
+		words_[index / 64] &= ~(1ull << (index % 64));
+	}
+
+	bool test( uint64_t index ) const {
+		return (words_[index / 64] & (1ull << (index % 64))) != 0;
+	}
+
+	bool empty() const {
+		for( unsigned int i = 0; i < word_count; ++i ) {
+			if( words_[i] ) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	uint64_t count() const {
+		uint64_t ret = 0;
+		for( unsigned int i = 0; i < word_count; ++i ) {
+			ret += popcount( words_[i] );
+		}
+		return ret;
+	}
+
+	// Returns the lowest index in the set and removes it from the set.
+	// Precondition: !empty()
+	uint64_t pop_first() {
+		unsigned int i = 0;
+		while( !words_[i] ) {
+			++i;
+		}
+		return i * 64 + bitscan_unset( words_[i] );
+	}
+
+private:
+	enum {
+		word_count = (MAX_THREADS + 63) / 64
+	};
+
+	uint64_t words_[word_count];
+};
+
+#endif
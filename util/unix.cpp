@@ -4,13 +4,29 @@
 #include <sys/time.h>
 #include <stdio.h>
 #include <errno.h>
+#include <fstream>
 #include <iostream>
+#include <string>
 #include <time.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #ifdef __APPLE__
 #include <sys/sysctl.h>
 #endif
+#ifdef __linux__
+#include <algorithm>
+#include <dirent.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <vector>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
 
 #if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
 #define MAP_ANONYMOUS MAP_ANON
@@ -57,19 +73,50 @@ int get_system_memory()
 }
 
 
+namespace {
+// The page in front of the returned pointer holds size and start of the mapping.
+void* set_allocation_header( void* base, uint64_t alloc, char* p )
+{
+	uint64_t* header = reinterpret_cast<uint64_t*>(p - get_page_size());
+	header[0] = alloc;
+	header[1] = reinterpret_cast<uint64_t>(base);
+	return p;
+}
+
+uint64_t const huge_page_size = 2 * 1024 * 1024;
+
+uint64_t round_up( uint64_t size, uint64_t alignment )
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+#if defined(MAP_HUGETLB) && !defined(MAP_HUGE_2MB)
+#define MAP_HUGE_2MB (21 << 26)
+#endif
+
+#ifdef MADV_HUGEPAGE
+bool transparent_huge_pages_disabled()
+{
+	std::ifstream in( "/sys/kernel/mm/transparent_hugepage/enabled" );
+	std::string line;
+	if( !std::getline( in, line ) ) {
+		return true;
+	}
+	return line.find( "[never]" ) != std::string::npos;
+}
+#endif
+}
+
+
 void* page_aligned_malloc( uint64_t size )
 {
 	uint64_t page_size = get_page_size();
-	uint64_t alloc = page_size + size;
-	if( size % page_size ) {
-		alloc += page_size - size % page_size;
-	}
+	uint64_t alloc = page_size + round_up( size, page_size );
 
 	void* p = mmap( 0, alloc, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0 );
 
 	if( p && p != MAP_FAILED ) {
-		*reinterpret_cast<uint64_t*>(p) = alloc;
-		return reinterpret_cast<char*>(p) + page_size;
+		return set_allocation_header( p, alloc, reinterpret_cast<char*>(p) + page_size );
 	}
 	else {
 		std::cerr << "Memory allocation failed: " << errno << std::endl;
@@ -78,13 +125,141 @@ void* page_aligned_malloc( uint64_t size )
 }
 
 
+void* huge_page_malloc( uint64_t size, page_type::type& type )
+{
+	type = page_type::regular;
+	if( size < huge_page_size ) {
+		return page_aligned_malloc( size );
+	}
+
+	uint64_t page_size = get_page_size();
+
+#ifdef MAP_HUGETLB
+	{
+		// Fails right away unless enough huge pages have been reserved through
+		// /proc/sys/vm/nr_hugepages. The huge pages are mapped into a larger
+		// block of regular ones, aligned to a huge page boundary with the
+		// header in the regular page in front. That way the header takes no
+		// huge page of its own.
+		uint64_t const rounded = round_up( size, huge_page_size );
+		uint64_t alloc = rounded + huge_page_size;
+		void* base = mmap( 0, alloc, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0 );
+		if( base && base != MAP_FAILED ) {
+			char* aligned = reinterpret_cast<char*>(round_up( reinterpret_cast<uint64_t>(base) + page_size, huge_page_size ));
+			void* m = mmap( aligned, rounded, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED|MAP_HUGETLB|MAP_HUGE_2MB, -1, 0 );
+			if( m != MAP_FAILED ) {
+				type = page_type::huge;
+				return set_allocation_header( base, alloc, aligned );
+			}
+			munmap( base, alloc );
+		}
+	}
+#endif
+
+#ifdef MADV_HUGEPAGE
+	if( !transparent_huge_pages_disabled() ) {
+		// Over-allocate so that the block can be aligned to a huge page boundary,
+		// only then can the kernel back it with huge pages.
+		uint64_t const rounded = round_up( size, huge_page_size );
+		uint64_t alloc = rounded + huge_page_size;
+		void* p = mmap( 0, alloc, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0 );
+		if( p && p != MAP_FAILED ) {
+			char* aligned = reinterpret_cast<char*>(round_up( reinterpret_cast<uint64_t>(p) + page_size, huge_page_size ));
+			if( !madvise( aligned, rounded, MADV_HUGEPAGE ) ) {
+				type = page_type::transparent_huge;
+			}
+			return set_allocation_header( p, alloc, aligned );
+		}
+	}
+#endif
+
+	return page_aligned_malloc( size );
+}
+
+
+namespace {
+std::string shared_memory_name( char const* name )
+{
+	// Portable names consist of a single leading slash followed by the name
+	std::string ret = name;
+	if( ret.empty() || ret[0] != '/' ) {
+		ret = "/" + ret;
+	}
+	return ret;
+}
+}
+
+
+void* map_shared_memory( char const* name, uint64_t size, bool& created )
+{
+	std::string const n = shared_memory_name( name );
+
+	created = true;
+	int fd = shm_open( n.c_str(), O_RDWR|O_CREAT|O_EXCL, 0600 );
+	if( fd == -1 && errno == EEXIST ) {
+		created = false;
+		fd = shm_open( n.c_str(), O_RDWR, 0 );
+	}
+	if( fd == -1 ) {
+		return 0;
+	}
+
+	if( created ) {
+		if( ftruncate( fd, size ) ) {
+			close( fd );
+			shm_unlink( n.c_str() );
+			return 0;
+		}
+	}
+	else {
+		// The creator might not have set the size yet
+		struct stat st;
+		st.st_size = 0;
+		for( int i = 0; i < 100 && !fstat( fd, &st ) && !st.st_size; ++i ) {
+			millisleep( 10 );
+		}
+		if( static_cast<uint64_t>(st.st_size) != size ) {
+			close( fd );
+			return 0;
+		}
+	}
+
+	// Reserve room for the allocation header in front of the shared mapping
+	uint64_t page_size = get_page_size();
+	uint64_t alloc = page_size + round_up( size, page_size );
+	void* base = mmap( 0, alloc, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0 );
+	if( !base || base == MAP_FAILED ) {
+		close( fd );
+		return 0;
+	}
+
+	char* p = reinterpret_cast<char*>(base) + page_size;
+	void* m = mmap( p, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_FIXED, fd, 0 );
+	close( fd );
+
+	if( m == MAP_FAILED ) {
+		munmap( base, alloc );
+		if( created ) {
+			shm_unlink( n.c_str() );
+		}
+		return 0;
+	}
+
+	return set_allocation_header( base, alloc, p );
+}
+
+
+void remove_shared_memory( char const* name )
+{
+	shm_unlink( shared_memory_name( name ).c_str() );
+}
+
+
 void aligned_free( void* p )
 {
 	if( p ) {
-		uint64_t page_size = get_page_size();
-		p = reinterpret_cast<char*>(p) - page_size;
-		uint64_t alloc = *reinterpret_cast<uint64_t*>(p);
-		int res = munmap( p, alloc );
+		uint64_t const* header = reinterpret_cast<uint64_t const*>(reinterpret_cast<char*>(p) - get_page_size());
+		int res = munmap( reinterpret_cast<void*>(header[1]), header[0] );
 		if( res ) {
 			std::cerr << "Deallocation failed: " << errno << std::endl;
 		}
@@ -97,6 +272,212 @@ uint64_t get_page_size()
 	return static_cast<uint64_t>(getpagesize());
 }
 
+
+#ifdef __linux__
+namespace {
+// From linux/mempolicy.h, not pulling in libnuma's numaif.h
+int const mpol_bind = 2;
+int const mpol_interleave = 3;
+unsigned int const mpol_mf_move = 1 << 1;
+
+unsigned int const max_numa_nodes = 1024;
+
+class numa_topology
+{
+public:
+	numa_topology()
+	{
+		CPU_ZERO( &allowed_ );
+		if( sched_getaffinity( 0, sizeof(cpu_set_t), &allowed_ ) ) {
+			for( unsigned int cpu = 0; cpu < get_cpu_count(); ++cpu ) {
+				CPU_SET( cpu, &allowed_ );
+			}
+		}
+
+		DIR* dir = opendir( "/sys/devices/system/node" );
+		if( dir ) {
+			std::vector<unsigned int> ids;
+			while( dirent* e = readdir( dir ) ) {
+				if( !strncmp( e->d_name, "node", 4 ) && e->d_name[4] >= '0' && e->d_name[4] <= '9' ) {
+					unsigned int id = atoi( e->d_name + 4 );
+					if( id < max_numa_nodes ) {
+						ids.push_back( id );
+					}
+				}
+			}
+			closedir( dir );
+
+			std::sort( ids.begin(), ids.end() );
+			for( auto id : ids ) {
+				std::vector<unsigned int> cpus = read_cpu_list( id );
+				if( !cpus.empty() ) {
+					node_ids_.push_back( id );
+					node_cpus_.push_back( cpus );
+				}
+			}
+		}
+
+		if( node_ids_.empty() ) {
+			// No NUMA information, treat as single node.
+			std::vector<unsigned int> cpus;
+			for( unsigned int cpu = 0; cpu < CPU_SETSIZE; ++cpu ) {
+				if( CPU_ISSET( cpu, &allowed_ ) ) {
+					cpus.push_back( cpu );
+				}
+			}
+			node_ids_.push_back( 0 );
+			node_cpus_.push_back( cpus );
+		}
+	}
+
+	// Parses lists of the form "0-7,16-23"
+	std::vector<unsigned int> read_cpu_list( unsigned int node ) const
+	{
+		std::vector<unsigned int> ret;
+
+		std::ifstream in( "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist" );
+		std::string list;
+		std::getline( in, list );
+
+		char const* s = list.c_str();
+		while( *s >= '0' && *s <= '9' ) {
+			char* end = 0;
+			unsigned int first = strtoul( s, &end, 10 );
+			unsigned int last = first;
+			if( *end == '-' ) {
+				last = strtoul( end + 1, &end, 10 );
+			}
+			for( unsigned int cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu ) {
+				if( CPU_ISSET( cpu, &allowed_ ) ) {
+					ret.push_back( cpu );
+				}
+			}
+			s = (*end == ',') ? end + 1 : end;
+		}
+
+		return ret;
+	}
+
+	cpu_set_t allowed_;
+
+	std::vector<unsigned int> node_ids_;
+	std::vector<std::vector<unsigned int>> node_cpus_;
+};
+
+numa_topology const& topology()
+{
+	static numa_topology t;
+	return t;
+}
+
+bool do_mbind( void* p, uint64_t size, int mode, unsigned long const* nodemask, unsigned int flags )
+{
+	// Kernel expects the number of bits in the mask plus one.
+	long res = syscall( SYS_mbind, p, size, mode, nodemask, nodemask ? max_numa_nodes + 1 : 0, flags );
+	return res == 0;
+}
+}
+
+
+unsigned int get_numa_node_count()
+{
+	return static_cast<unsigned int>(topology().node_ids_.size());
+}
+
+
+unsigned int pin_thread( uint64_t thread_index )
+{
+	numa_topology const& t = topology();
+
+	unsigned int node = thread_index % t.node_ids_.size();
+	std::vector<unsigned int> const& cpus = t.node_cpus_[node];
+	if( cpus.empty() ) {
+		return node;
+	}
+
+	cpu_set_t set;
+	CPU_ZERO( &set );
+	CPU_SET( cpus[(thread_index / t.node_ids_.size()) % cpus.size()], &set );
+	if( sched_setaffinity( 0, sizeof(cpu_set_t), &set ) ) {
+		std::cerr << "Could not set thread affinity: " << errno << std::endl;
+	}
+
+	return node;
+}
+
+
+void unpin_thread()
+{
+	cpu_set_t set = topology().allowed_;
+	sched_setaffinity( 0, sizeof(cpu_set_t), &set );
+}
+
+
+bool bind_memory_to_node( void* p, uint64_t size, unsigned int node )
+{
+	numa_topology const& t = topology();
+	if( t.node_ids_.size() < 2 || node >= t.node_ids_.size() ) {
+		return false;
+	}
+
+	unsigned long mask[max_numa_nodes / (8 * sizeof(unsigned long))] = {};
+	unsigned int const id = t.node_ids_[node];
+	mask[id / (8 * sizeof(unsigned long))] |= 1ul << (id % (8 * sizeof(unsigned long)));
+
+	uint64_t page_size = get_page_size();
+	size = (size + page_size - 1) / page_size * page_size;
+	return do_mbind( p, size, mpol_bind, mask, mpol_mf_move );
+}
+
+
+bool interleave_memory( void* p, uint64_t size )
+{
+	numa_topology const& t = topology();
+	if( t.node_ids_.size() < 2 ) {
+		return false;
+	}
+
+	unsigned long mask[max_numa_nodes / (8 * sizeof(unsigned long))] = {};
+	for( auto id : t.node_ids_ ) {
+		mask[id / (8 * sizeof(unsigned long))] |= 1ul << (id % (8 * sizeof(unsigned long)));
+	}
+
+	uint64_t page_size = get_page_size();
+	size = (size + page_size - 1) / page_size * page_size;
+	return do_mbind( p, size, mpol_interleave, mask, 0 );
+}
+
+#else
+
+unsigned int get_numa_node_count()
+{
+	return 1;
+}
+
+
+unsigned int pin_thread( uint64_t )
+{
+	return 0;
+}
+
+
+void unpin_thread()
+{
+}
+
+
+bool bind_memory_to_node( void*, uint64_t, unsigned int )
+{
+	return false;
+}
+
+
+bool interleave_memory( void*, uint64_t )
+{
+	return false;
+}
+#endif
+
 bool uses_native_popcnt()
 {
 	// We may lie
@@ -109,6 +490,63 @@ bool cpu_has_popcnt()
 	return true;
 }
 
+bool cpu_has_sse41()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports( "sse4.1" ) != 0;
+#else
+	return false;
+#endif
+}
+
+bool cpu_has_avx2()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports( "avx2" ) != 0;
+#else
+	return false;
+#endif
+}
+
+bool cpu_has_bmi2()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports( "bmi2" ) != 0;
+#else
+	return false;
+#endif
+}
+
+bool cpu_has_fast_pext()
+{
+	if( !cpu_has_bmi2() ) {
+		return false;
+	}
+
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned int eax, ebx, ecx, edx;
+	__cpuid( 0, eax, ebx, ecx, edx );
+
+	// "AuthenticAMD"
+	if( ebx != 0x68747541 || edx != 0x69746e65 || ecx != 0x444d4163 ) {
+		return true;
+	}
+
+	// Zen 3 is family 19h
+	__cpuid( 1, eax, ebx, ecx, edx );
+	unsigned int family = (eax >> 8) & 0xf;
+	if( family == 0xf ) {
+		family += (eax >> 20) & 0xff;
+	}
+	return family >= 0x19;
+#else
+	return false;
+#endif
+}
+
 void millisleep( int ms )
 {
 	timespec t;
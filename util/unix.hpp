@@ -55,6 +55,12 @@ inline uint64_t bitscan_reverse( uint64_t mask )
 #endif
 }
 
+// Hints the CPU to fetch the cache line containing p.
+inline void prefetch( void const* p )
+{
+	__builtin_prefetch( p );
+}
+
 #if USE_GENERIC_POPCOUNT
 #define popcount generic_popcount
 #else
@@ -1,6 +1,7 @@
 #include "platform.hpp"
 
 #include <windows.h>
+#include <immintrin.h>
 
 #include <algorithm>
 #include <iostream>
@@ -105,6 +106,27 @@ void* page_aligned_malloc( uint64_t size )
 }
 
 
+void* huge_page_malloc( uint64_t size, page_type::type& type )
+{
+	// Large pages on Windows need the SeLockMemoryPrivilege, don't bother.
+	type = page_type::regular;
+	return page_aligned_malloc( size );
+}
+
+
+void* map_shared_memory( char const*, uint64_t, bool& created )
+{
+	// Not implemented, callers fall back to private memory.
+	created = false;
+	return 0;
+}
+
+
+void remove_shared_memory( char const* )
+{
+}
+
+
 void aligned_free( void* p )
 {
 	if( p ) {
@@ -125,6 +147,35 @@ uint64_t get_page_size()
 	return info.dwPageSize;
 }
 
+
+unsigned int get_numa_node_count()
+{
+	return 1;
+}
+
+
+unsigned int pin_thread( uint64_t )
+{
+	return 0;
+}
+
+
+void unpin_thread()
+{
+}
+
+
+bool bind_memory_to_node( void*, uint64_t, unsigned int )
+{
+	return false;
+}
+
+
+bool interleave_memory( void*, uint64_t )
+{
+	return false;
+}
+
 bool uses_native_popcnt()
 {
 #if HAS_NATIVE_POPCOUNT
@@ -144,6 +195,74 @@ bool cpu_has_popcnt()
 	return (info[3] & (1 << 23)) != 0;
 }
 
+bool cpu_has_sse41()
+{
+	int info[4] = {0, 0, 0, 0};
+	__cpuid( info, 0x1 );
+
+	// Bit 19 of ecx indicates SSE4.1 support
+	return (info[2] & (1 << 19)) != 0;
+}
+
+bool cpu_has_avx2()
+{
+	int info[4] = {0, 0, 0, 0};
+	__cpuid( info, 0x0 );
+	if( info[0] < 7 ) {
+		return false;
+	}
+
+	// The OS needs to save the AVX registers on context switches: OSXSAVE and
+	// AVX support in ecx, then the XMM and YMM state bits in XCR0.
+	__cpuid( info, 0x1 );
+	if( (info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 ) {
+		return false;
+	}
+	if( (_xgetbv( 0 ) & 0x6) != 0x6 ) {
+		return false;
+	}
+
+	// Bit 5 of ebx indicates AVX2 support
+	__cpuidex( info, 0x7, 0x0 );
+	return (info[1] & (1 << 5)) != 0;
+}
+
+bool cpu_has_bmi2()
+{
+	int info[4] = {0, 0, 0, 0};
+	__cpuid( info, 0x0 );
+	if( info[0] < 7 ) {
+		return false;
+	}
+
+	// Bit 8 of ebx indicates BMI2 support
+	__cpuidex( info, 0x7, 0x0 );
+	return (info[1] & (1 << 8)) != 0;
+}
+
+bool cpu_has_fast_pext()
+{
+	if( !cpu_has_bmi2() ) {
+		return false;
+	}
+
+	int info[4] = {0, 0, 0, 0};
+	__cpuid( info, 0x0 );
+
+	// "AuthenticAMD"
+	if( info[1] != 0x68747541 || info[3] != 0x69746e65 || info[2] != 0x444d4163 ) {
+		return true;
+	}
+
+	// Zen 3 is family 19h
+	__cpuid( info, 0x1 );
+	int family = (info[0] >> 8) & 0xf;
+	if( family == 0xf ) {
+		family += (info[0] >> 20) & 0xff;
+	}
+	return family >= 0x19;
+}
+
 void millisleep( int ms )
 {
 	Sleep( static_cast<DWORD>(ms) );
@@ -84,6 +84,12 @@ inline uint64_t bitscan_reverse( uint64_t mask )
 #endif
 }
 
+// Hints the CPU to fetch the cache line containing p.
+inline void prefetch( void const* p )
+{
+	_mm_prefetch( reinterpret_cast<char const*>(p), _MM_HINT_T0 );
+}
+
 unsigned int get_cpu_count();
 
 // In MiB
@@ -5,6 +5,7 @@
 #include "eval.hpp"
 #include "fen.hpp"
 #include "hash.hpp"
+#include "nnue.hpp"
 #include "pawn_structure_hash_table.hpp"
 #include "see.hpp"
 #include "selftest.hpp"
@@ -502,8 +503,8 @@ void xboard( context& ctx, std::string line )
 	xboard_state state(ctx);
 	xboard_thread thread( state );
 
-	ctx.tt_.init( ctx.conf_.memory );
-	ctx.pawn_tt_.init( ctx.conf_.pawn_hash_table_size() );
+	ctx.tt_.init( ctx.conf_ );
+	ctx.pawn_tt_.init( ctx.conf_ );
 
 	if( !line.empty() ) {
 		goto skip_getline;
@@ -593,6 +594,13 @@ skip_getline:
 			std::cout << "feature memory=1\n";
 			std::cout << "feature smp=1\n";
 			std::cout << "feature option=\"MultiPV -spin 1 1 99\"\n";
+			std::cout << "feature option=\"SMP -combo " << (ctx.conf_.smp == smp_mode::lazy ? "YBWC /// *Lazy" : "*YBWC /// Lazy") << "\"\n";
+			std::cout << "feature option=\"HashFormat -combo " << (ctx.conf_.tt_format == hash_format::dense ? "Standard /// *Dense" : "*Standard /// Dense") << "\"\n";
+			std::cout << "feature option=\"NUMA -check " << (ctx.conf_.numa ? 1 : 0) << "\"\n";
+			std::cout << "feature option=\"SharedHash -string " << ctx.conf_.shared_hash << "\"\n";
+			std::cout << "feature option=\"PerThreadPawnHash -check " << (ctx.conf_.per_thread_pawn_hash ? 1 : 0) << "\"\n";
+			std::cout << "feature option=\"UseNNUE -check " << (ctx.conf_.use_nnue ? 1 : 0) << "\"\n";
+			std::cout << "feature option=\"EvalFile -file " << ctx.conf_.nnue_file << "\"\n";
 			std::cout << "feature exclude=1\n";
 			std::cout << "feature playother=1\n";
 			std::cout << "feature colors=0\n";
@@ -758,13 +766,23 @@ skip_getline:
 			unsigned int mem;
 			if( to_int<unsigned int>( args, mem, 4, 1024 * 1024 * 1024 ) ) {
 				ctx.conf_.memory = mem;
-				ctx.tt_.init(ctx.conf_.memory);
-				ctx.pawn_tt_.init( ctx.conf_.pawn_hash_table_size() );
+				ctx.tt_.init( ctx.conf_ );
+				ctx.pawn_tt_.init( ctx.conf_ );
 			}
 			else {
 				std::cout << "Error (bad command): Not a valid memory command" << std::endl;
 			}
 		}
+		else if( cmd == "savehash" ) {
+			if( !ctx.tt_.save( args, eval_version, nnue::evaluator_id() ) ) {
+				std::cout << "Error (command failed): savehash" << std::endl;
+			}
+		}
+		else if( cmd == "loadhash" ) {
+			if( !ctx.tt_.load( args, eval_version, nnue::evaluator_id() ) ) {
+				std::cout << "Error (command failed): loadhash" << std::endl;
+			}
+		}
 		else if( cmd == "cores" ) {
 			unsigned int cores;
 			if( to_int<unsigned int>( args, cores, 1, get_cpu_count() ) ) {
@@ -816,6 +834,74 @@ skip_getline:
 					thread.set_multipv( v );
 				}
 			}
+			else if( name == "SMP" ) {
+				if( value == "YBWC" ) {
+					ctx.conf_.smp = smp_mode::ybwc;
+				}
+				else if( value == "Lazy" ) {
+					ctx.conf_.smp = smp_mode::lazy;
+				}
+				else {
+					std::cout << "Error (bad command): Not a valid value" << std::endl;
+				}
+			}
+			else if( name == "HashFormat" ) {
+				if( value == "Standard" ) {
+					ctx.conf_.tt_format = hash_format::standard;
+					ctx.tt_.init( ctx.conf_ );
+				}
+				else if( value == "Dense" ) {
+					ctx.conf_.tt_format = hash_format::dense;
+					ctx.tt_.init( ctx.conf_ );
+				}
+				else {
+					std::cout << "Error (bad command): Not a valid value" << std::endl;
+				}
+			}
+			else if( name == "NUMA" ) {
+				if( value == "1" ) {
+					ctx.conf_.numa = true;
+					ctx.tt_.init( ctx.conf_ );
+				}
+				else if( value == "0" ) {
+					ctx.conf_.numa = false;
+					ctx.tt_.init( ctx.conf_ );
+				}
+				else {
+					std::cout << "Error (bad command): Not a valid value" << std::endl;
+				}
+			}
+			else if( name == "SharedHash" ) {
+				ctx.conf_.shared_hash = value;
+				ctx.tt_.init( ctx.conf_ );
+			}
+			else if( name == "PerThreadPawnHash" ) {
+				if( value == "1" ) {
+					ctx.conf_.per_thread_pawn_hash = true;
+				}
+				else if( value == "0" ) {
+					ctx.conf_.per_thread_pawn_hash = false;
+				}
+				else {
+					std::cout << "Error (bad command): Not a valid value" << std::endl;
+				}
+			}
+			else if( name == "UseNNUE" ) {
+				if( value == "1" || value == "0" ) {
+					// The transposition table holds evaluations of the previous evaluator.
+					ctx.conf_.use_nnue = value == "1";
+					nnue::init( ctx.conf_ );
+					ctx.tt_.init( ctx.conf_, true );
+				}
+				else {
+					std::cout << "Error (bad command): Not a valid value" << std::endl;
+				}
+			}
+			else if( name == "EvalFile" ) {
+				ctx.conf_.nnue_file = value;
+				nnue::init( ctx.conf_ );
+				ctx.tt_.init( ctx.conf_, true );
+			}
 			else {
 				std::cout << "Error (bad command): Not a known option" << std::endl;
 			}
@@ -895,7 +981,12 @@ skip_getline:
 			std::cout << board_to_string( state.p(), color::white );
 		}
 		else if( cmd == "perft" ) {
-			perft( state.p() );
+			perft( state.ctx_.conf_, state.p() );
+		}
+		else if( cmd == "perftcmp" ) {
+			int depth = 5;
+			to_int( args, depth, 1, 20 );
+			perft_compare( state.p(), depth );
 		}
 		else if( cmd == "pv" ) {
 			move pv[13];